@@ -30,4 +30,6 @@ if(SMGL_USE_BOOSTFS)
 else()
     set(SMGL_FS_LIB std::filesystem)
 endif()
-message(STATUS "Using filesystem library: ${SMGL_FS_LIB}")
\ No newline at end of file
+message(STATUS "Using filesystem library: ${SMGL_FS_LIB}")
+## Threads ##
+find_package(Threads REQUIRED)
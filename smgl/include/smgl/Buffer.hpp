@@ -0,0 +1,298 @@
+#pragma once
+
+/** @file */
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+#include "smgl/filesystem.hpp"
+
+namespace smgl
+{
+
+/** @brief Alignment of Buffer storage in bytes */
+constexpr std::size_t BufferAlignment{64};
+
+/** @brief Backing storage of a Buffer */
+enum class BufferStorage {
+    /** Aligned heap allocation */
+    Heap,
+    /** Anonymous memory map which requests huge pages */
+    HugePages,
+    /** Shared memory map of a file */
+    File
+};
+
+namespace detail
+{
+/** @brief Block of aligned memory shared by Buffers and their views */
+class BufferBlock
+{
+public:
+    /** Allocate aligned memory. Contents are uninitialized. */
+    static auto Allocate(std::size_t bytes) -> std::shared_ptr<BufferBlock>;
+
+    /**
+     * Map anonymous memory backed by huge pages if possible. Contents are
+     * zero initialized.
+     */
+    static auto AllocateHugePages(std::size_t bytes)
+        -> std::shared_ptr<BufferBlock>;
+
+    /**
+     * Map a file. If `resize` is true, the file is created if needed and
+     * resized to `bytes`. Otherwise, the whole file is mapped. Changes to the
+     * memory are written to the file.
+     */
+    static auto MapFile(
+        const filesystem::path& path, std::size_t bytes, bool resize)
+        -> std::shared_ptr<BufferBlock>;
+
+    /**
+     * Map a whole file read-only. Changes to the memory are copy-on-write and
+     * are never written to the file.
+     */
+    static auto MapFilePrivate(const filesystem::path& path)
+        -> std::shared_ptr<BufferBlock>;
+
+    /** Frees or unmaps the memory */
+    ~BufferBlock();
+
+    /** Disable copy */
+    BufferBlock(const BufferBlock&) = delete;
+    /** Disable copy */
+    BufferBlock& operator=(const BufferBlock&) = delete;
+
+    /** Start of the block */
+    auto data() const -> void*;
+    /** Size of the block in bytes */
+    auto bytes() const -> std::size_t;
+    /** Backing storage type */
+    auto storage() const -> BufferStorage;
+    /** Path of the mapped file. Empty if the block is not a file map. */
+    auto path() const -> const filesystem::path&;
+    /** Whether changes to the block are written to the mapped file */
+    auto sharedFile() const -> bool;
+    /** Flush changes to the mapped file */
+    void sync() const;
+
+private:
+    /** Constructor */
+    BufferBlock() = default;
+
+    /** Start of the block */
+    void* data_{nullptr};
+    /** Size of the block in bytes */
+    std::size_t bytes_{0};
+    /** Backing storage type */
+    BufferStorage storage_{BufferStorage::Heap};
+    /** Path of the mapped file */
+    filesystem::path path_;
+    /** Whether the file is mapped shared */
+    bool shared_{false};
+
+    /** Map a file with the given open flags and mmap flags */
+    static auto Map_(
+        const filesystem::path& path,
+        std::size_t bytes,
+        bool resize,
+        int openFlags,
+        int mapFlags) -> std::shared_ptr<BufferBlock>;
+};
+
+/**
+ * Size in bytes of `size` elements of type T
+ *
+ * @throws std::length_error if the size does not fit in std::size_t
+ */
+template <typename T>
+auto ByteSize(std::size_t size) -> std::size_t;
+
+/**
+ * Write bytes to path. The bytes are written to a temporary file which then
+ * replaces path, so existing maps of path remain valid.
+ */
+void WriteBytes(
+    const filesystem::path& path, const void* data, std::size_t bytes);
+}  // namespace detail
+
+/**
+ * @brief Large, aligned array for passing bulk data through ports
+ *
+ * A Buffer is a reference-counted handle to a block of memory which is
+ * aligned to BufferAlignment bytes. Copying a Buffer, including passing it
+ * through a port, copies the handle and not the data. Use clone() to copy
+ * the data.
+ *
+ * Buffers can be backed by the heap, by huge pages, or by a memory-mapped
+ * file. File-backed Buffers can be larger than the available RAM:
+ *
+ * ```{.cpp}
+ * // 4 GiB volume stored in a file
+ * auto vol = Buffer<float>::MapFile("volume.raw", 1024 * 1024 * 1024);
+ * // Zero-copy view of the first slice
+ * auto slice = vol.view(0, 1024 * 1024);
+ * ```
+ *
+ * Constness of a Buffer does not apply to its elements, since all copies of a
+ * Buffer share the same memory. As with Shared<T>, Nodes should not modify a
+ * Buffer which they have posted to an OutputPort.
+ *
+ * @tparam T Element type. Must be trivially copyable.
+ */
+template <typename T>
+class Buffer
+{
+    static_assert(
+        std::is_trivially_copyable<T>::value,
+        "Buffer elements must be trivially copyable");
+
+public:
+    /** Element type */
+    using value_type = T;
+    /** Iterator type */
+    using iterator = T*;
+
+    /** @brief Construct an empty Buffer */
+    Buffer() = default;
+
+    /**
+     * @brief Allocate a Buffer with `size` elements on the heap
+     *
+     * Contents are uninitialized.
+     *
+     * @throws std::length_error if the size in bytes overflows
+     */
+    explicit Buffer(std::size_t size);
+
+    /** @brief Allocate a Buffer with `size` copies of `value` */
+    Buffer(std::size_t size, const T& value);
+
+    /**
+     * @brief Allocate a Buffer with `size` elements backed by huge pages
+     *
+     * Falls back to regular pages if huge pages are not available. Contents
+     * are zero initialized.
+     */
+    static auto HugePages(std::size_t size) -> Buffer;
+
+    /**
+     * @brief Create a Buffer with `size` elements backed by a file
+     *
+     * The file is created if it does not exist and is resized to hold `size`
+     * elements. Changes to the Buffer are written to the file.
+     *
+     * @throws std::length_error if the size in bytes overflows
+     * @throws std::runtime_error if the file cannot be mapped
+     */
+    static auto MapFile(const filesystem::path& path, std::size_t size)
+        -> Buffer;
+
+    /**
+     * @brief Map an existing file into a Buffer
+     *
+     * Changes to the Buffer are written to the file.
+     *
+     * @throws std::runtime_error if the file cannot be mapped
+     */
+    static auto OpenFile(const filesystem::path& path) -> Buffer;
+
+    /**
+     * @brief Map an existing file into a Buffer without write access
+     *
+     * The file is opened read-only. Changes to the Buffer are copy-on-write,
+     * so they are never written to the file.
+     *
+     * @throws std::runtime_error if the file cannot be mapped
+     */
+    static auto OpenFileCopy(const filesystem::path& path) -> Buffer;
+
+    /** @brief Pointer to the first element */
+    auto data() const -> T*;
+    /** @brief Number of elements */
+    auto size() const -> std::size_t;
+    /** @brief Size in bytes */
+    auto bytes() const -> std::size_t;
+    /** @brief Returns true if the Buffer has no elements */
+    auto empty() const -> bool;
+
+    /** @brief Iterator to the first element */
+    auto begin() const -> iterator;
+    /** @brief Iterator past the last element */
+    auto end() const -> iterator;
+    /** @brief Access an element */
+    auto operator[](std::size_t idx) const -> T&;
+
+    /**
+     * @brief Get a view of `count` elements starting at `offset`
+     *
+     * The view shares memory with this Buffer. It is only aligned to
+     * BufferAlignment if `offset * sizeof(T)` is a multiple of it.
+     *
+     * @throws std::out_of_range if the range is not within the Buffer
+     */
+    auto view(std::size_t offset, std::size_t count) const -> Buffer;
+
+    /** @brief Copy the elements into a new heap Buffer */
+    auto clone() const -> Buffer;
+
+    /** @brief Backing storage type */
+    auto storage() const -> BufferStorage;
+
+    /** @brief Path of the backing file. Empty if not file-backed. */
+    auto path() const -> filesystem::path;
+
+    /** @brief Returns true if changes are written to the backing file */
+    auto sharedFile() const -> bool;
+
+    /** @brief Number of Buffers which share this Buffer's memory */
+    auto use_count() const -> long;
+
+    /** @brief Flush changes of a file-backed Buffer to its file */
+    void sync() const;
+
+private:
+    /** Construct from a block */
+    Buffer(std::shared_ptr<detail::BufferBlock> block, T* data, std::size_t n);
+
+    /** Shared storage */
+    std::shared_ptr<detail::BufferBlock> block_;
+    /** First element */
+    T* data_{nullptr};
+    /** Number of elements */
+    std::size_t size_{0};
+};
+
+/**
+ * @brief Write a Buffer to a file
+ *
+ * Writes directly from the Buffer's memory. If the Buffer is already a shared
+ * map of the file at path, its changes are only flushed. Intended for use in
+ * Node::serialize_ to cache a Buffer without copying it:
+ *
+ * ```{.cpp}
+ * Metadata serialize_(bool useCache, const filesystem::path& dir) override {
+ *     if (useCache) {
+ *         WriteBuffer(dir / "volume.raw", vol_);
+ *     }
+ *     return {{"volume", "volume.raw"}};
+ * }
+ * ```
+ */
+template <typename T>
+void WriteBuffer(const filesystem::path& path, const Buffer<T>& buffer);
+
+/**
+ * @brief Load a Buffer written by WriteBuffer()
+ *
+ * The file is memory-mapped, so pages are only read when they are accessed.
+ * It is opened read-only and changes to the Buffer are copy-on-write, so the
+ * cached file is never modified. See Buffer::OpenFileCopy().
+ */
+template <typename T>
+auto LoadBuffer(const filesystem::path& path) -> Buffer<T>;
+
+}  // namespace smgl
+
+#include "smgl/BufferImpl.hpp"
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace smgl
+{
+
+template <typename T>
+auto detail::ByteSize(std::size_t size) -> std::size_t
+{
+    if (size > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+        throw std::length_error("Buffer size in bytes overflows");
+    }
+    return size * sizeof(T);
+}
+
+template <typename T>
+Buffer<T>::Buffer(std::size_t size)
+    : block_{detail::BufferBlock::Allocate(detail::ByteSize<T>(size))}
+    , data_{static_cast<T*>(block_->data())}
+    , size_{size}
+{
+}
+
+template <typename T>
+Buffer<T>::Buffer(std::size_t size, const T& value) : Buffer(size)
+{
+    std::fill(begin(), end(), value);
+}
+
+template <typename T>
+Buffer<T>::Buffer(
+    std::shared_ptr<detail::BufferBlock> block, T* data, std::size_t n)
+    : block_{std::move(block)}, data_{data}, size_{n}
+{
+}
+
+template <typename T>
+auto Buffer<T>::HugePages(std::size_t size) -> Buffer
+{
+    auto bytes = detail::ByteSize<T>(size);
+    auto block = detail::BufferBlock::AllocateHugePages(bytes);
+    auto data = static_cast<T*>(block->data());
+    return {std::move(block), data, size};
+}
+
+template <typename T>
+auto Buffer<T>::MapFile(const filesystem::path& path, std::size_t size)
+    -> Buffer
+{
+    auto bytes = detail::ByteSize<T>(size);
+    auto block = detail::BufferBlock::MapFile(path, bytes, true);
+    auto data = static_cast<T*>(block->data());
+    return {std::move(block), data, size};
+}
+
+template <typename T>
+auto Buffer<T>::OpenFile(const filesystem::path& path) -> Buffer
+{
+    auto block = detail::BufferBlock::MapFile(path, 0, false);
+    auto data = static_cast<T*>(block->data());
+    auto size = block->bytes() / sizeof(T);
+    return {std::move(block), data, size};
+}
+
+template <typename T>
+auto Buffer<T>::OpenFileCopy(const filesystem::path& path) -> Buffer
+{
+    auto block = detail::BufferBlock::MapFilePrivate(path);
+    auto data = static_cast<T*>(block->data());
+    auto size = block->bytes() / sizeof(T);
+    return {std::move(block), data, size};
+}
+
+template <typename T>
+auto Buffer<T>::data() const -> T*
+{
+    return data_;
+}
+
+template <typename T>
+auto Buffer<T>::size() const -> std::size_t
+{
+    return size_;
+}
+
+template <typename T>
+auto Buffer<T>::bytes() const -> std::size_t
+{
+    return size_ * sizeof(T);
+}
+
+template <typename T>
+auto Buffer<T>::empty() const -> bool
+{
+    return size_ == 0;
+}
+
+template <typename T>
+auto Buffer<T>::begin() const -> iterator
+{
+    return data_;
+}
+
+template <typename T>
+auto Buffer<T>::end() const -> iterator
+{
+    return data_ + size_;
+}
+
+template <typename T>
+auto Buffer<T>::operator[](std::size_t idx) const -> T&
+{
+    return data_[idx];
+}
+
+template <typename T>
+auto Buffer<T>::view(std::size_t offset, std::size_t count) const -> Buffer
+{
+    if (offset > size_ or count > size_ - offset) {
+        throw std::out_of_range("Buffer view out of range");
+    }
+    return {block_, data_ + offset, count};
+}
+
+template <typename T>
+auto Buffer<T>::clone() const -> Buffer
+{
+    Buffer copy(size_);
+    if (size_ > 0) {
+        std::memcpy(copy.data(), data_, bytes());
+    }
+    return copy;
+}
+
+template <typename T>
+auto Buffer<T>::storage() const -> BufferStorage
+{
+    return (block_) ? block_->storage() : BufferStorage::Heap;
+}
+
+template <typename T>
+auto Buffer<T>::path() const -> filesystem::path
+{
+    return (block_) ? block_->path() : filesystem::path();
+}
+
+template <typename T>
+auto Buffer<T>::sharedFile() const -> bool
+{
+    return block_ and block_->sharedFile();
+}
+
+template <typename T>
+auto Buffer<T>::use_count() const -> long
+{
+    return block_.use_count();
+}
+
+template <typename T>
+void Buffer<T>::sync() const
+{
+    if (block_) {
+        block_->sync();
+    }
+}
+
+template <typename T>
+void WriteBuffer(const filesystem::path& path, const Buffer<T>& buffer)
+{
+    // A full shared map of the destination only needs to be flushed
+    if (buffer.sharedFile() and
+        filesystem::absolute(buffer.path()) == filesystem::absolute(path) and
+        buffer.bytes() == filesystem::file_size(path)) {
+        buffer.sync();
+        return;
+    }
+    detail::WriteBytes(path, buffer.data(), buffer.bytes());
+}
+
+template <typename T>
+auto LoadBuffer(const filesystem::path& path) -> Buffer<T>
+{
+    return Buffer<T>::OpenFileCopy(path);
+}
+
+}  // namespace smgl
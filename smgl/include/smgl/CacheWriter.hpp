@@ -0,0 +1,93 @@
+#pragma once
+
+/** @file */
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace smgl
+{
+
+/**
+ * @brief Background thread which runs cache writes in order
+ *
+ * Used by Graph to overlap writing the cache with updating Nodes. Tasks are
+ * run one at a time in submission order. The queue is bounded: submit()
+ * blocks while `capacity()` tasks are waiting, so a slow disk applies
+ * backpressure to the update instead of accumulating unbounded state.
+ *
+ * Tasks may throw. The first exception is stored and rethrown by flush().
+ *
+ * ```{.cpp}
+ * smgl::CacheWriter writer;
+ * writer.submit([meta]() { smgl::WriteMetadata("graph.json", meta); });
+ * writer.flush();
+ * ```
+ */
+class CacheWriter
+{
+public:
+    /** Task type */
+    using Task = std::function<void()>;
+
+    /** @brief Default number of tasks which can wait in the queue */
+    static constexpr std::size_t DefaultCapacity{64};
+
+    /** @brief Construct and start the writer thread */
+    explicit CacheWriter(std::size_t capacity = DefaultCapacity);
+
+    /** Disable copy */
+    CacheWriter(const CacheWriter&) = delete;
+    /** Disable copy */
+    CacheWriter& operator=(const CacheWriter&) = delete;
+
+    /**
+     * @brief Finishes all queued tasks and joins the writer thread
+     *
+     * Errors which have not been reported by flush() are discarded.
+     */
+    ~CacheWriter();
+
+    /** @brief Get the maximum number of waiting tasks */
+    auto capacity() const -> std::size_t;
+
+    /** @brief Queue a task. Blocks while the queue is full. */
+    void submit(Task task);
+
+    /**
+     * @brief Wait for all queued tasks to finish
+     *
+     * Rethrows the first exception thrown by a task since the last flush().
+     */
+    void flush();
+
+private:
+    /** Writer thread main loop */
+    void run_();
+
+    /** Queue capacity */
+    std::size_t capacity_;
+    /** Queued tasks */
+    std::deque<Task> tasks_;
+    /** Whether the writer thread is running a task */
+    bool busy_{false};
+    /** Shutdown flag */
+    bool stop_{false};
+    /** First unreported task error */
+    std::exception_ptr error_;
+    /** Queue lock */
+    std::mutex mutex_;
+    /** Signaled when a task is queued or on shutdown */
+    std::condition_variable queued_;
+    /** Signaled when a task is dequeued or finished */
+    std::condition_variable progress_;
+    /** Writer thread */
+    std::thread thread_;
+};
+
+}  // namespace smgl
@@ -4,6 +4,9 @@
 
 #include <exception>
 #include <functional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace smgl
 {
@@ -53,7 +56,7 @@ namespace detail
  * @brief Abstract Factory class
  *
  * This factory uses RTTI to allow looking up an existing object's registered
- * type identifier.
+ * type identifier. All member functions are thread-safe.
  *
  * @tparam BaseClass Base type of object managed by factory
  * @tparam IdentifierType Identifier type (e.g. std::string)
@@ -113,6 +116,8 @@ private:
     NameMap typeToIDMap_;
     /** Holds mappings from IdentifierType -> ProduceCreator */
     TypeMap idToCreatorMap_;
+    /** Guards the maps. Creation runs without holding the lock. */
+    mutable std::shared_timed_mutex mutex_;
 };
 
 }  // namespace detail
@@ -1,3 +1,6 @@
+#include <mutex>
+#include <shared_mutex>
+
 namespace smgl
 {
 namespace policy
@@ -41,6 +44,7 @@ template <
     class E>
 void Factory<B, I, A, P, E>::Reserve(std::size_t count)
 {
+    std::unique_lock<std::shared_timed_mutex> lock(mutex_);
     typeToIDMap_.reserve(count);
     idToCreatorMap_.reserve(count);
 }
@@ -54,6 +58,7 @@ template <
     class E>
 void Factory<B, I, A, P, E>::ReserveAdditional(std::size_t count)
 {
+    std::unique_lock<std::shared_timed_mutex> lock(mutex_);
     typeToIDMap_.reserve(count + typeToIDMap_.size());
     idToCreatorMap_.reserve(count + idToCreatorMap_.size());
 }
@@ -68,6 +73,7 @@ template <
 bool Factory<B, I, A, P, E>::Register(
     const I& id, P creator, const std::type_info& info)
 {
+    std::unique_lock<std::shared_timed_mutex> lock(mutex_);
     auto res = idToCreatorMap_.insert({id, creator}).second;
     if (res) {
         res = typeToIDMap_.insert({info.hash_code(), id}).second;
@@ -87,6 +93,7 @@ template <
     class E>
 bool Factory<B, I, A, P, E>::Deregister(const I& id)
 {
+    std::unique_lock<std::shared_timed_mutex> lock(mutex_);
     // emulate std::erase_if from C++20
     auto oldSize = typeToIDMap_.size();
     for (auto it = typeToIDMap_.begin(), last = typeToIDMap_.end();
@@ -110,9 +117,17 @@ template <
     class E>
 A Factory<B, I, A, P, E>::CreateObject(const I& id)
 {
-    auto it = idToCreatorMap_.find(id);
-    if (it != idToCreatorMap_.end()) {
-        return (it->second)();
+    // Copy the creator so that objects are constructed without the lock
+    P creator;
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(mutex_);
+        auto it = idToCreatorMap_.find(id);
+        if (it != idToCreatorMap_.end()) {
+            creator = it->second;
+        }
+    }
+    if (creator) {
+        return creator();
     }
     return this->OnUnknownType(id);
 }
@@ -125,9 +140,12 @@ template <
     class E>
 I Factory<B, I, A, P, E>::GetTypeIdentifier(const std::type_info& info)
 {
-    auto it = typeToIDMap_.find(info.hash_code());
-    if (it != typeToIDMap_.end()) {
-        return it->second;
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(mutex_);
+        auto it = typeToIDMap_.find(info.hash_code());
+        if (it != typeToIDMap_.end()) {
+            return it->second;
+        }
     }
     return this->OnUnnamedType(info);
 }
@@ -141,6 +159,7 @@ template <
     class E>
 std::vector<I> Factory<B, I, A, P, E>::GetRegisteredIdentifiers() const
 {
+    std::shared_lock<std::shared_timed_mutex> lock(mutex_);
     std::vector<I> keys;
     for (const auto& t : idToCreatorMap_) {
         keys.push_back(t.first);
@@ -157,6 +176,7 @@ template <
     class E>
 bool Factory<B, I, A, P, E>::IsRegistered(const IDType& id)
 {
+    std::shared_lock<std::shared_timed_mutex> lock(mutex_);
     return idToCreatorMap_.find(id) != idToCreatorMap_.end();
 }
 
@@ -169,6 +189,7 @@ template <
     class E>
 bool Factory<B, I, A, P, E>::IsRegistered(const std::type_info& info)
 {
+    std::shared_lock<std::shared_timed_mutex> lock(mutex_);
     return typeToIDMap_.find(info.hash_code()) != typeToIDMap_.end();
 }
 
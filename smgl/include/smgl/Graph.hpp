@@ -2,12 +2,19 @@
 
 /** @file */
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <functional>
+#include <future>
 #include <memory>
+#include <stdexcept>
 #include <unordered_map>
 #include <vector>
 
+#include "smgl/CacheWriter.hpp"
 #include "smgl/Node.hpp"
+#include "smgl/ThreadPool.hpp"
 #include "smgl/Uuid.hpp"
 #include "smgl/filesystem.hpp"
 
@@ -16,6 +23,42 @@ namespace smgl
 
 // Pre-declare for Graphviz
 class GraphStyle;
+// Pre-declare for Graph::updateAsync
+class UpdateHandle;
+
+namespace detail
+{
+/** @brief Shared progress and cancellation state of a Graph update */
+struct UpdateStatus {
+    /** Set to request cancellation */
+    std::atomic<bool> cancelled{false};
+    /** Number of scheduled Nodes which have been processed */
+    std::atomic<std::size_t> completed{0};
+    /** Number of scheduled Nodes */
+    std::atomic<std::size_t> total{0};
+};
+}  // namespace detail
+
+/**
+ * @brief Exception thrown when a Graph cannot be scheduled because it
+ * contains a cycle
+ */
+struct cycle_error : public std::runtime_error {
+public:
+    /** Construct with the Uuids of the Nodes which form the cycle */
+    explicit cycle_error(std::vector<Uuid> cycle);
+    /**
+     * @brief Get the Nodes which form the cycle
+     *
+     * Each Node has an output connection to the next Node in the list, and
+     * the last Node is connected to the first.
+     */
+    auto cycle() const -> const std::vector<Uuid>&;
+
+protected:
+    /** Nodes in the cycle */
+    std::vector<Uuid> cycle_;
+};
 
 /** @brief Cache Location Type */
 enum class CacheType {
@@ -25,6 +68,77 @@ enum class CacheType {
     Subdirectory
 };
 
+/**
+ * @brief Immutable, index-based update plan for a Graph
+ *
+ * Produced by Graph::compile(). Stores the Graph's Nodes in schedule order
+ * along with their dependencies as contiguous arrays of indices into
+ * nodes(). Executing a plan does not require any Uuid lookups or hashing.
+ */
+class ExecutionPlan
+{
+public:
+    /** @brief Contiguous range of Node indices */
+    struct IndexRange {
+        /** First index */
+        const std::size_t* first{nullptr};
+        /** One past the last index */
+        const std::size_t* last{nullptr};
+        /** Iterator to the first index */
+        auto begin() const -> const std::size_t* { return first; }
+        /** Iterator to one past the last index */
+        auto end() const -> const std::size_t* { return last; }
+        /** Number of indices */
+        auto size() const -> std::size_t
+        {
+            return static_cast<std::size_t>(last - first);
+        }
+    };
+
+    /** @brief Get the number of Nodes in the plan */
+    auto size() const -> std::size_t;
+
+    /**
+     * @brief Get the Nodes in schedule order
+     *
+     * Every Node comes after all of its upstream Nodes.
+     */
+    auto nodes() const -> const std::vector<Node::Pointer>&;
+
+    /**
+     * @brief Get the depth of Node `i`
+     *
+     * @copydetails Graph::ScheduleLevels()
+     */
+    auto level(std::size_t i) const -> std::size_t;
+
+    /** @brief Get the indices of the unique downstream Nodes of Node `i` */
+    auto successors(std::size_t i) const -> IndexRange;
+
+    /** @brief Get the indices of the unique upstream Nodes of Node `i` */
+    auto predecessors(std::size_t i) const -> IndexRange;
+
+private:
+    /** Friend: Graph builds and executes plans */
+    friend class Graph;
+
+    /** Nodes in schedule order */
+    std::vector<Node::Pointer> order_;
+    /** Depth of each Node */
+    std::vector<std::size_t> levels_;
+    /**
+     * Offsets into successors_. The downstream Nodes of `order_[i]` are
+     * stored in `successors_[offsets_[i]]` to `successors_[offsets_[i + 1]]`.
+     */
+    std::vector<std::size_t> offsets_;
+    /** Indices of each Node's unique downstream Nodes */
+    std::vector<std::size_t> successors_;
+    /** Offsets into predecessors_. Arranged like offsets_. */
+    std::vector<std::size_t> predOffsets_;
+    /** Indices of each Node's unique upstream Nodes */
+    std::vector<std::size_t> predecessors_;
+};
+
 /**
  * @brief A collection of Nodes for managing pipeline state and serialization
  */
@@ -91,6 +205,22 @@ public:
      */
     void setCacheType(CacheType t);
 
+    /**
+     * @brief Get the file format of the cache file
+     *
+     * @copydetails setCacheFormat()
+     */
+    auto cacheFormat() const -> MetadataFormat;
+
+    /**
+     * @brief Set the file format of the cache file
+     *
+     * By default (MetadataFormat::Auto), the format is selected by the
+     * extension of cacheFile(). Binary formats are smaller and faster to
+     * write for Nodes with large serialized data.
+     */
+    void setCacheFormat(MetadataFormat format);
+
     /**
      * @brief Returns the cache directory as configured by cacheFile() and
      * cacheType()
@@ -111,6 +241,31 @@ public:
      */
     void setEnableCache(bool enable);
 
+    /**
+     * @brief Whether update() returns before the cache has been written
+     *
+     * @copydetails setAsyncCache()
+     */
+    auto asyncCache() const -> bool;
+
+    /**
+     * @brief Set whether update() returns before the cache has been written
+     *
+     * When caching is enabled, Nodes are serialized as they finish and the
+     * results are written to the cache file by a background CacheWriter
+     * thread. By default, update() waits for these writes to finish. If
+     * `async` is true, update() returns as soon as the Nodes have updated.
+     * Call flushCache() before reading the cache file.
+     */
+    void setAsyncCache(bool async);
+
+    /**
+     * @brief Wait for all pending cache writes to finish
+     *
+     * Rethrows the first error raised while writing the cache.
+     */
+    void flushCache();
+
     /** @brief Set the project metadata */
     void setProjectMetadata(const Metadata& m);
 
@@ -120,54 +275,162 @@ public:
     /** @copydoc projectMetadata() const */
     auto projectMetadata() -> Metadata&;
 
+    /**
+     * @brief Get the number of threads used by update()
+     *
+     * @copydetails setNumThreads()
+     */
+    auto numThreads() const -> std::size_t;
+
+    /**
+     * @brief Set the number of threads used by update()
+     *
+     * If `n == 1` (the default), Nodes are updated serially in schedule order.
+     * Otherwise, Nodes are updated on a work-stealing ThreadPool with `n`
+     * workers, and every Node is launched as soon as all of its upstream
+     * Nodes have finished. If `n == 0`, the number of hardware threads is
+     * used. The same number of threads is used to serialize Nodes in
+     * Serialize() and Save().
+     *
+     * @warning Parallel execution requires that Node::compute implementations
+     * only modify state owned by their Node.
+     */
+    void setNumThreads(std::size_t n);
+
+    /**
+     * @brief Compile the Graph into an ExecutionPlan
+     *
+     * The plan is cached and is only rebuilt when Nodes are inserted or
+     * removed or when ports are connected or disconnected. update()
+     * compiles the Graph as needed, but calling compile() ahead of time
+     * moves the cost of scheduling out of the first update.
+     *
+     * @throws smgl::cycle_error if the Graph contains a cycle
+     */
+    auto compile() -> std::shared_ptr<const ExecutionPlan>;
+
     /**
      * @brief Update the Graph's nodes
      *
-     * Schedules the Nodes of the Graph and update them as needed.
+     * Compiles the Graph (see compile()) and updates the Nodes as needed.
      */
     auto update() -> State;
 
+    /**
+     * @brief Update only the Nodes needed to produce the given Nodes
+     *
+     * Updates the target Nodes and all of their upstream Nodes. Every other
+     * Node is skipped and keeps its queued input updates, which are applied
+     * by the next call to update().
+     *
+     * @throws std::invalid_argument if a target Node is null or is not in the
+     * Graph
+     */
+    auto update(const std::vector<Node::Pointer>& targets) -> State;
+
+    /**
+     * @brief Update the Graph's nodes on a background thread
+     *
+     * Performs update() asynchronously and returns a handle which can be used
+     * to wait for the result, monitor progress, and cancel the update.
+     * Cancellation is checked before each Node is updated, and long-running
+     * Nodes may poll Node::cancelled() to return early. Nodes which are
+     * skipped because of a cancellation keep their queued input updates, so a
+     * later update resumes where the cancelled update stopped.
+     *
+     * @warning The Graph and its Nodes must not be modified or destroyed
+     * until the update has finished.
+     */
+    auto updateAsync() -> UpdateHandle;
+
+    /** Stream feed callback type */
+    using Feed = std::function<bool(std::size_t)>;
+
+    /**
+     * @brief Update the Graph's nodes over a stream of frames
+     *
+     * Calls `feed(tick)` for `tick = 0, 1, 2, ...` until it returns false.
+     * Each call should post the input values for frame `tick` to the Graph's
+     * source Nodes. Every frame is propagated through the Graph as in
+     * update(), but frames are pipelined: a Node computes frame `tick` as
+     * soon as its upstream Nodes have finished frame `tick` and its
+     * downstream Nodes have received frame `tick - 1` on their inputs, even
+     * if they are still computing it. With more than one thread (see
+     * setNumThreads()), different stages of the Graph work on different
+     * frames concurrently. Every Node processes frames in order, so sinks
+     * receive results in the order in which they were fed.
+     *
+     * Node::tick() returns the frame which a Node is computing. `feed` is
+     * only called once every source Node has received the previous frame.
+     */
+    auto stream(const Feed& feed) -> State;
+
     /**
      * @brief Serialize a Graph to a Metadata object
      *
+     * If numThreads() is not 1, Nodes are serialized concurrently on a
+     * ThreadPool. The result does not depend on the number of threads.
+     *
      * @warning This function honors the value of cacheEnabled() and will write
      * data to cacheDir().
+     *
+     * @warning Parallel serialization requires that Node::serialize_
+     * implementations only write to their own cache directory.
      */
     static auto Serialize(const Graph& g) -> Metadata;
 
     /**
-     * @brief Save a Graph to a JSON file
+     * @brief Save a Graph to a file
      *
      * If writeCache is true, cache information will be written adjacent to
-     * the provided path honoring the cacheType() configuration.
+     * the provided path honoring the cacheType() configuration. Nodes are
+     * serialized as in Serialize().
      *
      * @param path Path to output file
      * @param g Graph to be saved
      * @param writeCache Whether or not to write cache files
+     * @param format File format. By default, selected by the extension of
+     * path (e.g. `.json`, `.cbor`, `.msgpack`, `.ubj`).
      */
     static auto Save(
-        const filesystem::path& path, const Graph& g, bool writeCache = false)
-        -> void;
+        const filesystem::path& path,
+        const Graph& g,
+        bool writeCache = false,
+        MetadataFormat format = MetadataFormat::Auto) -> void;
 
     /**
-     * @brief Load a Graph from a JSON file
+     * @brief Load a Graph from a file
+     *
+     * The file format is detected from the file contents.
      *
      * @note Loaded Graph does not share state with any preexisting Graph. See
      * <a href="https://code.cs.uky.edu/csparker247/smgl/-/issues/9">issue
      * #9</a>.
      *
-     * @param path Path to input file in the JSON format
+     * If `numThreads` is not 1, Nodes are constructed and deserialized
+     * concurrently on a ThreadPool with `numThreads` workers (0 uses the
+     * number of hardware threads) while the file is read. Connections are
+     * made afterwards on the calling thread. The loaded Graph uses the same
+     * number of threads for update().
+     *
+     * @warning Parallel loading requires that Node constructors and
+     * Node::deserialize_ implementations only modify state owned by their
+     * Node.
+     *
+     * @param path Path to input file written by Save()
+     * @param numThreads Number of threads used to deserialize Nodes
      */
-    static auto Load(const filesystem::path& path) -> Graph;
+    static auto Load(const filesystem::path& path, std::size_t numThreads = 1)
+        -> Graph;
 
     /**
-     * @brief Checks that a Graph JSON file can be loaded
+     * @brief Checks that a Graph file can be loaded
      *
      * Checks that every Node in the Graph is registered with the serialization
      * system. Returns the list of unregistered types as strings so that missing
      * registrations can be handled appropriately before calling Graph::Load.
      *
-     * @param path Path to input file in the JSON format
+     * @param path Path to input file written by Save()
      * @return List of Node types that are not registered for serialization
      */
     static auto CheckRegistration(const filesystem::path& path)
@@ -191,16 +454,33 @@ public:
      * @brief Generate an update schedule for the provided Graph
      *
      * Traverses the Graph and produces an ordered schedule for updating
-     * Nodes. Graph must have at least one Node with no input connections and
-     * must be acyclic.
+     * Nodes. Every Node is scheduled after all of its upstream Nodes.
+     * Connections to Nodes which are not in the Graph are ignored.
+     *
+     * @throws smgl::cycle_error if the Graph contains a cycle
      */
     static auto Schedule(const Graph& g) -> std::vector<Node::Pointer>;
 
+    /**
+     * @brief Generate a leveled update schedule for the provided Graph
+     *
+     * Groups the Graph's Nodes by depth. Level 0 contains the Nodes with no
+     * upstream Nodes, and every other Node is placed one level below its
+     * deepest upstream Node. Nodes in the same level do not depend on each
+     * other and can be updated concurrently.
+     *
+     * @throws smgl::cycle_error if the Graph contains a cycle
+     */
+    static auto ScheduleLevels(const Graph& g)
+        -> std::vector<std::vector<Node::Pointer>>;
+
 private:
     /** Cache file */
     filesystem::path cacheFile_;
     /** Cache type */
     CacheType cacheType_{CacheType::Subdirectory};
+    /** Cache file format */
+    MetadataFormat cacheFormat_{MetadataFormat::Auto};
     /** Cache enabled state */
     bool cache_enabled_{false};
     /** List of Graph's nodes */
@@ -209,6 +489,88 @@ private:
     State state_{State::Idle};
     /** Extra metadata */
     Metadata extraMetadata_;
+    /** Number of update threads */
+    std::size_t numThreads_{1};
+    /** Thread pool for parallel updates */
+    std::shared_ptr<ThreadPool> pool_;
+    /** Whether update() returns before the cache has been written */
+    bool asyncCache_{false};
+    /** Background cache writer */
+    std::shared_ptr<CacheWriter> cacheWriter_;
+
+    /** Topology version. Incremented by insertNode() and removeNode(). */
+    std::uint64_t version_{0};
+    /** Topology version of the compiled plan */
+    std::uint64_t planVersion_{0};
+    /** Connection epoch of the compiled plan */
+    std::uint64_t planEpoch_{0};
+    /** Compiled update plan */
+    std::shared_ptr<const ExecutionPlan> plan_;
+
+    /** Topologically sort the Nodes of the Graph */
+    static auto Sort(const Graph& g) -> ExecutionPlan;
+
+    /** Status of the current update */
+    std::shared_ptr<detail::UpdateStatus> status_;
+
+    /** Update all Nodes and report progress to status */
+    auto update_all_(std::shared_ptr<detail::UpdateStatus> status) -> State;
+
+    /**
+     * Update the scheduled Nodes. If not empty, `active[i]` selects whether
+     * `plan_->nodes()[i]` is updated. The active set must include all
+     * upstream Nodes of every active Node.
+     */
+    auto update_(
+        const std::vector<bool>& active,
+        std::shared_ptr<detail::UpdateStatus> status) -> State;
+
+    /** Attach a new update status to the Graph and its Nodes */
+    void set_status_(std::shared_ptr<detail::UpdateStatus> status);
+
+    /** Update Nodes serially in schedule order */
+    void update_serial_(
+        const std::vector<bool>& active,
+        const std::shared_ptr<detail::MetadataJournal>& journal,
+        const filesystem::path& cacheDir);
+
+    /** Update Nodes in parallel as their dependencies complete */
+    void update_parallel_(
+        const std::vector<bool>& active,
+        const std::shared_ptr<detail::MetadataJournal>& journal,
+        const filesystem::path& cacheDir);
+
+    /** Update Nodes as a pipelined stream of frames */
+    void update_stream_(
+        const Feed& feed,
+        const std::shared_ptr<detail::MetadataJournal>& journal,
+        const filesystem::path& cacheDir);
+
+    /** (Re)build the thread pool with the configured number of threads */
+    void start_pool_();
+
+    /**
+     * Start a cache journal for an update. Returns null if caching is
+     * disabled.
+     */
+    auto open_cache_(const filesystem::path& cacheDir)
+        -> std::shared_ptr<detail::MetadataJournal>;
+
+    /** Serialize a Node and queue it for the cache journal */
+    void cache_node_(
+        const std::shared_ptr<detail::MetadataJournal>& journal,
+        const Node::Pointer& n,
+        const filesystem::path& cacheDir);
+
+    /** Queue compaction of the cache journal and wait unless asynchronous */
+    void close_cache_(const std::shared_ptr<detail::MetadataJournal>& journal);
+
+    /**
+     * Close the cache after a failed update. Cache errors are logged so that
+     * they do not replace the update's error.
+     */
+    void abort_cache_(
+        const std::shared_ptr<detail::MetadataJournal>& journal) noexcept;
 
     /** Perform graph serialization */
     static auto Serialize(
@@ -221,6 +583,79 @@ private:
         -> void;
 };
 
+/**
+ * @brief Handle to an asynchronous Graph update
+ *
+ * Returned by Graph::updateAsync(). Handles can be copied, and all copies
+ * refer to the same update.
+ *
+ * ```{.cpp}
+ * auto handle = graph.updateAsync();
+ * while (handle.wait_for(std::chrono::milliseconds(100)) !=
+ *        std::future_status::ready) {
+ *     std::cout << handle.completed() << "/" << handle.total() << "\n";
+ *     if (userChangedParameter) {
+ *         handle.cancel();
+ *     }
+ * }
+ * handle.get();
+ * ```
+ */
+class UpdateHandle
+{
+public:
+    /** Default constructor creates an invalid handle */
+    UpdateHandle() = default;
+
+    /** @brief Whether the handle refers to an update */
+    auto valid() const -> bool;
+
+    /**
+     * @brief Request that the update stop
+     *
+     * The update stops before the next Node is updated. Use wait() to wait
+     * for the update to stop.
+     */
+    void cancel();
+
+    /** @brief Whether cancellation has been requested */
+    auto cancelled() const -> bool;
+
+    /** @brief Number of scheduled Nodes which have been processed */
+    auto completed() const -> std::size_t;
+
+    /** @brief Number of scheduled Nodes */
+    auto total() const -> std::size_t;
+
+    /** @brief Wait for the update to finish */
+    void wait() const;
+
+    /** @brief Wait for the update to finish or for a timeout to elapse */
+    template <class Rep, class Period>
+    auto wait_for(const std::chrono::duration<Rep, Period>& timeout) const
+        -> std::future_status;
+
+    /**
+     * @brief Wait for the update to finish and get the result of
+     * Graph::update()
+     *
+     * Rethrows any exception thrown by the update.
+     */
+    auto get() const -> Graph::State;
+
+private:
+    /** Friend: Graph constructs handles */
+    friend class Graph;
+    /** Construct from the update result and status */
+    UpdateHandle(
+        std::shared_future<Graph::State> result,
+        std::shared_ptr<detail::UpdateStatus> status);
+    /** Update result */
+    std::shared_future<Graph::State> result_;
+    /** Update status */
+    std::shared_ptr<detail::UpdateStatus> status_;
+};
+
 }  // namespace smgl
 
 #include "smgl/GraphImpl.hpp"
\ No newline at end of file
@@ -20,4 +20,12 @@ auto Graph::insertNodes(N& n0, Ns&&... nodes) -> void
 #endif
 }
 
+template <class Rep, class Period>
+auto UpdateHandle::wait_for(
+    const std::chrono::duration<Rep, Period>& timeout) const
+    -> std::future_status
+{
+    return result_.wait_for(timeout);
+}
+
 }  // namespace smgl
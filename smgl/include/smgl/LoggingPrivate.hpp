@@ -1,5 +1,6 @@
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 
 #include "smgl/Logging.hpp"
 #include "smgl/Singleton.hpp"
@@ -16,6 +17,7 @@ class LoggingConfig
 private:
     LogLevel level_{LogLevel::None};
     std::ostream* out_;
+    std::mutex mutex_;
 
 public:
     LoggingConfig() : out_{&std::cerr} { *out_ << std::boolalpha; }
@@ -29,6 +31,8 @@ public:
     auto out() -> std::ostream& { return *out_; }
 
     void out(std::ostream* out) { out_ = out; }
+
+    auto mutex() -> std::mutex& { return mutex_; }
 };
 
 using LogConf = SingletonHolder<LoggingConfig>;
@@ -64,6 +68,7 @@ void LogError(Args... args)
         return;
     }
 
+    std::lock_guard<std::mutex> lock(detail::LogConf::Instance().mutex());
     detail::LogStart("[smgl] [error]");
     detail::LogMessage(std::forward<Args>(args)...);
 }
@@ -75,6 +80,7 @@ void LogWarning(Args... args)
         return;
     }
 
+    std::lock_guard<std::mutex> lock(detail::LogConf::Instance().mutex());
     detail::LogStart("[smgl] [warning]");
     detail::LogMessage(std::forward<Args>(args)...);
 }
@@ -86,6 +92,7 @@ void LogInfo(Args... args)
         return;
     }
 
+    std::lock_guard<std::mutex> lock(detail::LogConf::Instance().mutex());
     detail::LogStart("[smgl] [info]");
     detail::LogMessage(std::forward<Args>(args)...);
 }
@@ -97,6 +104,7 @@ void LogDebug(Args... args)
         return;
     }
 
+    std::lock_guard<std::mutex> lock(detail::LogConf::Instance().mutex());
     detail::LogStart("[smgl] [debug]");
     detail::LogMessage(std::forward<Args>(args)...);
 }
@@ -2,6 +2,9 @@
 
 /** @file */
 
+#include <fstream>
+#include <string>
+
 #include <nlohmann/json.hpp>
 
 #include "smgl/filesystem.hpp"
@@ -11,10 +14,151 @@ namespace smgl
 /** @brief Metadata storage class */
 using Metadata = nlohmann::ordered_json;
 
-/** @brief Write Metadata to path in JSON format */
-void WriteMetadata(const filesystem::path& path, const Metadata& m);
+/** @brief File format of serialized Metadata */
+enum class MetadataFormat {
+    /**
+     * Select by file extension when writing and by file contents when
+     * loading
+     */
+    Auto,
+    /** Pretty-printed JSON text */
+    JSON,
+    /** Concise Binary Object Representation (.cbor) */
+    CBOR,
+    /** MessagePack (.msgpack, .mpk) */
+    MsgPack,
+    /** Universal Binary JSON (.ubj, .ubjson) */
+    UBJSON
+};
+
+/**
+ * @brief Write Metadata to path
+ *
+ * With MetadataFormat::Auto, the format is selected by the extension of
+ * path. Unknown extensions are written as JSON.
+ */
+void WriteMetadata(
+    const filesystem::path& path,
+    const Metadata& m,
+    MetadataFormat format = MetadataFormat::Auto);
+
+/**
+ * @brief Load Metadata from path
+ *
+ * With MetadataFormat::Auto, the format is detected from the file contents.
+ */
+Metadata LoadMetadata(
+    const filesystem::path& path,
+    MetadataFormat format = MetadataFormat::Auto);
+
+namespace detail
+{
+/**
+ * @brief Append-only log of Node updates to a Graph's cache file
+ *
+ * Rewriting the full cache file after every Node is quadratic in the size of
+ * the Graph. Instead, the starting state is written once and each serialized
+ * Node is appended as a single JSON line to a journal file beside it. The
+ * journal is folded into the cache file by compact(). If the process stops
+ * before then, Replay() recovers the recorded Nodes.
+ */
+class MetadataJournal
+{
+public:
+    /** @brief Get the journal file for a Metadata file */
+    static auto Path(const filesystem::path& json) -> filesystem::path;
+
+    /**
+     * @brief Get the Node states recorded in the journal of `json`
+     *
+     * Returns an object which maps Node Uuids to their latest recorded
+     * state. Incomplete trailing records are ignored.
+     */
+    static auto Replay(const filesystem::path& json) -> Metadata;
+
+    /**
+     * @brief Write the starting state to `json` and begin an empty journal
+     *
+     * The journal itself is always JSON text. `format` is used for the
+     * Metadata file.
+     */
+    void open(
+        const filesystem::path& json,
+        Metadata meta,
+        MetadataFormat format = MetadataFormat::Auto);
+
+    /** @brief Whether the journal is open */
+    auto isOpen() const -> bool;
+
+    /** @brief Record the serialized state of a Node */
+    void append(const std::string& uuid, Metadata node);
+
+    /**
+     * @brief Write the recorded state to the Metadata file and remove the
+     * journal
+     */
+    void compact();
+
+private:
+    /** Metadata file */
+    filesystem::path json_;
+    /** Current state */
+    Metadata meta_;
+    /** Metadata file format */
+    MetadataFormat format_{MetadataFormat::Auto};
+    /** Journal file stream */
+    std::ofstream log_;
+};
+
+/**
+ * @brief Receives the contents of a Metadata object as VisitMetadata() reads
+ * it
+ *
+ * Top-level members are passed to member() once they have been read. For
+ * members selected by stream(), each element is instead passed to element()
+ * as soon as it has been read. Only the current element is held in memory.
+ */
+class MetadataVisitor
+{
+public:
+    /** Default destructor */
+    virtual ~MetadataVisitor() = default;
+
+    /** @brief Whether the elements of member `key` are visited separately */
+    virtual auto stream(const std::string& key) -> bool;
+
+    /**
+     * @brief Whether to read `field` of the elements of streamed member `key`
+     *
+     * Fields which are not read are skipped by the parser.
+     */
+    virtual auto keep(const std::string& key, const std::string& field)
+        -> bool;
+
+    /** @brief Visit a top-level member */
+    virtual void member(const std::string& key, Metadata&& value);
+
+    /**
+     * @brief Visit an element of streamed member `key`
+     *
+     * `name` is the element's key if the member is an object and is empty if
+     * the member is an array.
+     */
+    virtual void element(
+        const std::string& key, const std::string& name, Metadata&& value);
+};
 
-/** @brief Load Metadata from JSON file at path */
-Metadata LoadMetadata(const filesystem::path& path);
+/**
+ * @brief Read a Metadata object from path and pass its contents to visitor
+ *
+ * With MetadataFormat::Auto, the format is detected from the file contents.
+ *
+ * @throws std::runtime_error if the file cannot be parsed or is not an object
+ */
+void VisitMetadata(
+    const filesystem::path& path,
+    MetadataVisitor& visitor,
+    MetadataFormat format = MetadataFormat::Auto);
+}  // namespace detail
 
 }  // namespace smgl
@@ -2,6 +2,7 @@
 
 /** @file */
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
@@ -170,9 +171,39 @@ public:
     /** @brief Get the number of active output connections */
     auto getNumberOfOutputConnections() const -> size_t;
 
-    /** @brief Get the current update state */
+    /**
+     * @brief Get the current update state
+     *
+     * The Node's InputPorts report their state changes to the Node as they
+     * happen, so this is a constant-time query.
+     */
     auto state() -> State;
 
+    /**
+     * @brief Returns true if any OutputPort is blocked
+     *
+     * Graph updates skip a blocked Node and leave it Ready until its
+     * consumers have drained their queues. See QueuedInputPort.
+     */
+    auto blocked() const -> bool;
+
+    /**
+     * @brief Get the tick of the current update
+     *
+     * During Graph::stream(), the graph-wide sequence number of the frame
+     * which is being computed. Otherwise, 0.
+     */
+    auto tick() const -> std::size_t;
+
+    /**
+     * @brief Whether the Graph update which is running this Node has been
+     * cancelled
+     *
+     * Long-running compute functions can poll this value and return early.
+     * Always false if the Node is not being updated by a Graph.
+     */
+    auto cancelled() const -> bool;
+
 protected:
     /** Protected constructor can only be called by child class */
     Node();
@@ -188,11 +219,11 @@ protected:
      * computation which are not always easy to identify.
      */
     template <typename T>
-    void registerInputPort(const std::string& name, InputPort<T>& port);
+    void registerInputPort(const std::string& name, TypedInput<T>& port);
 
     /** @copydoc registerInputPort() */
     template <typename T>
-    void registerPort(const std::string& name, InputPort<T>& port);
+    void registerPort(const std::string& name, TypedInput<T>& port);
 
     /**
      * @brief Register an OutputPort instance with this class
@@ -342,12 +373,23 @@ private:
      */
     auto update_input_ports_() -> bool;
 
+    /** Compute and send the results once the inputs have been received */
+    void compute_and_send_();
+
     /** Notify output ports of this Node's update state */
     void notify_output_ports_(Port::State s);
 
     /** Send queued update on all output ports */
     auto update_output_ports_() -> bool;
 
+    /** Track the state change of a registered InputPort */
+    void input_state_changed_(Port::State from, Port::State to);
+
+    /** Friend: Generic Input port class reports state changes */
+    friend Input;
+    /** Friend: Graph sets the update tick and cancellation flag */
+    friend class Graph;
+
     /**
      * Convenience method for loading existing port information and updating
      * port registrations
@@ -367,8 +409,20 @@ private:
     std::unordered_map<Uuid, Output*> outputs_by_uuid_;
     /** Stores registered outputs by registered name */
     std::map<std::string, Output*> outputs_by_name_;
+    /** Registered inputs in registration order. Used by update(). */
+    std::vector<Input*> inputs_;
+    /** Registered outputs in registration order. Used by update(). */
+    std::vector<Output*> outputs_;
     /** Current Node state */
     State state_{State::Idle};
+    /** Number of registered InputPorts in the Waiting state */
+    std::atomic<std::size_t> waiting_inputs_{0};
+    /** Number of registered InputPorts in the Queued state */
+    std::atomic<std::size_t> queued_inputs_{0};
+    /** Tick of the current update */
+    std::size_t tick_{0};
+    /** Cancellation flag of the current update */
+    std::shared_ptr<const std::atomic<bool>> cancelled_;
 };
 
 namespace detail
@@ -380,8 +434,11 @@ namespace detail
  * provided in the top-level namespace: RegisterNode(), DeregisterNode(),
  * CreateNode(), NodeName()
  */
-using NodeFactoryType =
-    SingletonHolder<Factory<Node, std::string, Node::Pointer>>;
+using NodeFactoryType = SingletonHolder<
+    Factory<Node, std::string, Node::Pointer>,
+    policy::CreateStatic,
+    policy::DefaultLifetime,
+    policy::ClassLevelLockable>;
 }  // namespace detail
 
 /** Thrown by NodeFactoryType when attempting to access an unregistered type */
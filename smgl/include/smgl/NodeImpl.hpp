@@ -32,16 +32,18 @@ void Node::LoadAndRegisterPort(
 }
 
 template <typename T>
-void Node::registerInputPort(const std::string& name, InputPort<T>& port)
+void Node::registerInputPort(const std::string& name, TypedInput<T>& port)
 {
     port.setParent(this);
     inputs_by_uuid_[port.uuid()] = &port;
     assert(inputs_by_name_.find(name) == inputs_by_name_.end());
     inputs_by_name_[name] = &port;
+    inputs_.push_back(&port);
+    input_state_changed_(Port::State::Idle, port.state());
 }
 
 template <typename T>
-void Node::registerPort(const std::string& name, InputPort<T>& port)
+void Node::registerPort(const std::string& name, TypedInput<T>& port)
 {
     registerInputPort(name, port);
 }
@@ -54,6 +56,7 @@ void Node::registerOutputPort(
     outputs_by_uuid_[port.uuid()] = &port;
     assert(outputs_by_name_.find(name) == outputs_by_name_.end());
     outputs_by_name_[name] = &port;
+    outputs_.push_back(&port);
 }
 
 template <typename T, typename... Args>
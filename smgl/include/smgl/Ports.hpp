@@ -2,13 +2,22 @@
 
 /** @file */
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <exception>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
 #include "smgl/Metadata.hpp"
+#include "smgl/Utilities.hpp"
 #include "smgl/Uuid.hpp"
 
 namespace smgl
@@ -38,10 +47,38 @@ struct Update {
     std::size_t tick{0};
 };
 
+/**
+ * @brief Immutable, reference-counted payload
+ *
+ * Connections between ports of type `Shared<T>` pass a pointer to a single
+ * immutable object instead of copying the object for every connection. Use
+ * this for large values (e.g. images or volumes) which are fanned out to
+ * many consumers:
+ *
+ * ```{.cpp}
+ * class Producer : public Node {
+ *     Shared<Volume> vol_;
+ * public:
+ *     SharedOutputPort<Volume> volume{&vol_};
+ *     Producer() {
+ *         registerPort("volume", volume);
+ *         compute = [this]() { vol_ = std::make_shared<const Volume>(...); };
+ *     }
+ * };
+ * ```
+ *
+ * Nodes must replace the pointer instead of modifying the object it points
+ * to, since the object may still be in use by downstream Nodes.
+ */
+template <typename T>
+using Shared = std::shared_ptr<const T>;
+
 /** @cond */
 class Input;
 class Output;
 template <typename T>
+class TypedInput;
+template <typename T>
 class InputPort;
 template <typename T, typename... Args>
 class OutputPort;
@@ -62,6 +99,129 @@ void connect(Output& op, Input& ip);
  */
 void disconnect(Output& op, Input& ip);
 
+namespace detail
+{
+/**
+ * @brief Get the global connection epoch
+ *
+ * The epoch is incremented every time any pair of ports is connected or
+ * disconnected. It can be compared against a previously observed value to
+ * cheaply detect that the port topology may have changed.
+ */
+auto ConnectionEpoch() -> std::uint64_t;
+
+/**
+ * @brief Inline storage for a pointer to member function
+ *
+ * Large enough for member function pointers of classes with single
+ * inheritance on all common ABIs. Ports fall back to std::function for
+ * larger callables.
+ */
+struct MemberFnStorage {
+    /** Storage bytes */
+    alignas(void*) unsigned char bytes[2 * sizeof(void*)];
+};
+
+/** Whether Fn can be stored in MemberFnStorage */
+template <class Fn>
+using FitsMemberFnStorage = std::integral_constant<
+    bool,
+    sizeof(Fn) <= sizeof(MemberFnStorage) and
+        alignof(Fn) <= alignof(MemberFnStorage) and
+        std::is_trivially_copyable<Fn>::value>;
+
+/**
+ * @brief Target of an input port
+ *
+ * Stores a pointer to a target object, a member function target, or a
+ * std::function target. The invoker tags which one is stored, and the
+ * object pointer is shared by all three. Member functions which fit in
+ * MemberFnStorage are stored inline.
+ */
+template <typename T>
+class PortTarget
+{
+public:
+    /** @brief Construct with pointer to target object */
+    explicit PortTarget(T* target);
+
+    /** @brief Construct with std::function target */
+    explicit PortTarget(std::function<void(T)> target);
+
+    /** @brief Construct with member function target */
+    template <class Obj, class ObjMemberFn>
+    PortTarget(Obj* obj, ObjMemberFn&& fn);
+
+    /** Disable copy */
+    PortTarget(const PortTarget&) = delete;
+    /** Disable copy */
+    PortTarget& operator=(const PortTarget&) = delete;
+
+    /** @brief Destructor */
+    ~PortTarget();
+
+    /** @brief Pass a value to the target. The value is moved from. */
+    void apply(T& v);
+
+private:
+    /** Calls a member function or std::function target */
+    using Invoker = void (*)(void*, const MemberFnStorage&, T&);
+    /**
+     * Target object pointer, member function object, or owned
+     * std::function. If invoke_ is null, this is a T* which is assigned
+     * directly.
+     */
+    void* target_{nullptr};
+    /** Target invoker */
+    Invoker invoke_{nullptr};
+    /** Member function target */
+    MemberFnStorage memberFn_{};
+
+    /** Store a std::function target */
+    void set_function_(std::function<void(T)> fn);
+    /** Store a member function target inline */
+    template <class Obj, class Fn>
+    void set_member_(Obj* obj, Fn&& fn, std::true_type);
+    /** Store a member function target which does not fit inline */
+    template <class Obj, class Fn>
+    void set_member_(Obj* obj, Fn&& fn, std::false_type);
+    /** Invoker for member function targets */
+    template <class Obj, class Fn>
+    static void InvokeMember_(void* obj, const MemberFnStorage& fn, T& v);
+    /** Invoker for std::function targets */
+    static void InvokeFunction_(
+        void* fn, const MemberFnStorage& /*unused*/, T& v);
+};
+
+/**
+ * @brief Deferred read of an OutputPort value
+ *
+ * Posted by lazy OutputPorts in place of a value. Calling it computes the
+ * value, or returns the value already computed for another connection.
+ */
+template <typename T>
+struct Pull {
+    /** Source port */
+    Output* port{nullptr};
+    /** Reads the value of port */
+    T (*read)(Output*){nullptr};
+
+    /** Returns true if the pull is set */
+    explicit operator bool() const { return read != nullptr; }
+    /** Read the value */
+    auto operator()() const -> T { return read(port); }
+};
+
+/** Number of OutputPort connections stored without a heap allocation */
+constexpr std::size_t InlineConnections{1};
+
+/**
+ * OutputPorts with more connections than this also keep a hash index of their
+ * connections. Smaller fan-outs are searched linearly.
+ */
+constexpr std::size_t ConnectionIndexThreshold{16};
+}  // namespace detail
+
 /** @copydoc connect() */
 void operator>>(Output& op, Input& ip);
 /** @copydoc connect() */
@@ -103,7 +263,7 @@ public:
     State state() const;
 
     /** Set the port's state */
-    void setState(State s);
+    virtual void setState(State s);
 
     /** Set the port's parent node */
     void setParent(Node* p);
@@ -122,7 +282,7 @@ protected:
     /** Default destructor */
     virtual ~Port() = default;
     /** Current state */
-    State state_{State::Idle};
+    std::atomic<State> state_{State::Idle};
     /** Parent node */
     Node* parent_{nullptr};
 };
@@ -132,18 +292,26 @@ class Input : public Port
 {
 public:
     /** Get a list of port connections */
-    std::vector<Connection> getConnections() const;
+    virtual std::vector<Connection> getConnections() const;
 
     /**
      * @brief Get the number of connections
      *
      * 1 if connected to an output port, 0 otherwise.
      */
-    std::size_t numConnections() const;
+    virtual std::size_t numConnections() const;
 
     /** @copydoc smgl::connect() */
     virtual Input& operator=(Output& op);
 
+    /**
+     * @brief Set the port's state
+     *
+     * Also updates the pending input counters of the parent Node so that the
+     * Node's state can be queried without scanning all of its ports.
+     */
+    void setState(State s) override;
+
 protected:
     /** Default constructor */
     Input();
@@ -155,10 +323,23 @@ protected:
     /** Disconnect from an output port */
     virtual void disconnect(Output* op) final;
 
+    /** Add an output port to the port's sources */
+    virtual void add_source_(Output* op);
+    /** Remove an output port from the port's sources if present */
+    virtual auto remove_source_(Output* op) -> bool;
+
+    /** Describe the connection from an output port to this port */
+    auto connection_(Output* op) const -> Connection;
+    /** Remove this port from an output port's connections */
+    void release_(Output* op);
+
     /** Pointer to connected output port */
     Output* src_{nullptr};
-    /** Tick of last received update */
-    std::size_t last_updated_{0};
+    /**
+     * Tick of last received update. Updates posted with a tick which is not
+     * newer than this value are stale.
+     */
+    std::atomic<std::size_t> last_updated_{0};
 
 private:
     /** Friend: smgl::connect */
@@ -178,6 +359,11 @@ public:
     virtual std::vector<Connection> getConnections() const = 0;
     /** Get the number of port connections */
     virtual std::size_t numConnections() const = 0;
+    /**
+     * Returns true if any connected port is full. Graph updates defer the
+     * parent Node until the full ports have been drained.
+     */
+    virtual auto blocked() const -> bool;
 
 protected:
     /** Default constructor */
@@ -199,6 +385,61 @@ private:
     friend Input;
 };
 
+/**
+ * @brief Generic typed input port interface
+ *
+ * Base class for input ports which can be connected to an OutputPort<T>.
+ *
+ * @tparam T Type of object received by this port
+ */
+template <typename T>
+class TypedInput : public Input
+{
+public:
+    /**
+     * @brief Post an update to the port
+     *
+     * The target is not updated until update() has been called.
+     */
+    void post(const Update<T>& u);
+
+    /** @copydoc post(const Update<T>& u) */
+    virtual void post(Update<T>&& u) = 0;
+
+    /**
+     * @brief Returns true if the port cannot accept another update without
+     * blocking or dropping an update
+     */
+    virtual auto full() const -> bool;
+
+protected:
+    /** Default constructor */
+    TypedInput() = default;
+
+    /**
+     * Receive notice that the source's value did not change. Any update which
+     * has not yet been applied is queued again, otherwise the port returns to
+     * Idle.
+     */
+    virtual void unchanged_() = 0;
+
+    /** Receive an update from a connected OutputPort */
+    virtual void receive_(Output* src, Update<T>&& u);
+    /** Receive a state update from a connected OutputPort */
+    virtual void receive_state_(Output* src, State s);
+    /** Receive notice that a connected OutputPort's value did not change */
+    virtual void receive_unchanged_(Output* src);
+    /**
+     * Receive a deferred value from a lazy OutputPort. By default, the value
+     * is read immediately.
+     */
+    virtual void receive_lazy_(Output* src, detail::Pull<T> pull);
+
+    /** Friend: typed OutputPort class */
+    template <typename OutputValType, typename... OutputArgs>
+    friend class OutputPort;
+};
+
 /**
  * @brief Typed InputPort class
  *
@@ -206,14 +447,22 @@ private:
  * to a target object or function. It is similar to a setter function.
  * T should be default constructible.
  *
+ * Posted values are held in a single-slot, latest-value-wins mailbox. post()
+ * and update() are lock-free, so an acquisition thread may post to a port
+ * while the graph thread updates it. Values which are replaced before they
+ * are consumed are dropped.
+ *
  * @tparam T Type of object received by this port
  */
 template <typename T>
-class InputPort : public Input
+class InputPort : public TypedInput<T>
 {
 public:
-    /** Default destructor */
-    ~InputPort() override = default;
+    /** Port state type */
+    using State = Port::State;
+
+    /** Destructor */
+    ~InputPort() override;
 
     /** @brief Construct with pointer to target object */
     explicit InputPort(T* target);
@@ -241,6 +490,9 @@ public:
      */
     void post(const Update<T>& u);
 
+    /** @copydoc post(const Update<T>& u) */
+    void post(Update<T>&& u) override;
+
     /**
      * @brief Post an update to the port
      *
@@ -275,10 +527,331 @@ public:
     void deserialize(const Metadata& m) override;
 
 private:
-    /** Target object updated by std::function */
-    std::function<void(T)> target_;
-    /** Most recently posted update */
-    Update<T> queued_update_;
+    /** Port target */
+    detail::PortTarget<T> target_;
+
+    /** @brief Mailbox entry */
+    struct Slot {
+        /** Posted update */
+        Update<T> update;
+        /** If set, the value of update is read from a lazy OutputPort */
+        detail::Pull<T> pull;
+    };
+
+    /** Most recently posted update which has not been applied */
+    std::atomic<Slot*> mailbox_{nullptr};
+    /** Recycled update storage */
+    std::atomic<Slot*> spare_{nullptr};
+
+    /** Take recycled update storage or allocate new storage */
+    auto acquire_slot_() -> Slot*;
+    /** Recycle update storage which is no longer in the mailbox */
+    void release_slot_(Slot* slot);
+    /** Return an update to the mailbox unless a newer one was posted */
+    void requeue_slot_(Slot* slot);
+    /** Place an update in the mailbox, replacing any unconsumed update */
+    void publish_(Slot* slot);
+    /** Set state to Idle, or Queued if an update arrived in the meantime */
+    void idle_();
+
+    /** @copydoc TypedInput::unchanged_() */
+    void unchanged_() override;
+    /** Defer reading the value until update() */
+    void receive_lazy_(Output* src, detail::Pull<T> pull) override;
+    /** Also drops a deferred value which has not been read from op */
+    auto remove_source_(Output* op) -> bool override;
+};
+
+/** @brief How a QueuedInputPort handles posts to a full queue */
+enum class OverflowPolicy {
+    /** Wait until a queued value is consumed */
+    Block,
+    /** Drop the oldest queued value */
+    DropOldest,
+    /** Drop the posted value */
+    DropNewest
+};
+
+/**
+ * @brief InputPort which queues up to N posted values
+ *
+ * Unlike InputPort, which only keeps the most recently posted value, a
+ * QueuedInputPort keeps posted values in a bounded ring buffer. Each call to
+ * update() passes the oldest queued value to the target. The port remains
+ * Queued while values are left in the queue, so the parent Node is ready
+ * again on the next Graph update.
+ *
+ * When the queue is full, post() follows the port's OverflowPolicy. With
+ * OverflowPolicy::Block, post() waits until update() consumes a value.
+ * Connected OutputPorts report a full queue with OutputPort::blocked(), and
+ * Graph updates defer a Node while any of its outputs is blocked, so a Node
+ * never blocks the thread which is updating the Graph. Values posted
+ * directly with post() or OutputPort::update() still block until a value is
+ * consumed, so they should come from a thread other than the one updating
+ * the Graph.
+ *
+ * @tparam T Type of object received by this port
+ * @tparam N Maximum number of queued values
+ */
+template <typename T, std::size_t N>
+class QueuedInputPort : public TypedInput<T>
+{
+    static_assert(N > 0, "QueuedInputPort capacity must be greater than 0");
+
+public:
+    /** Port state type */
+    using State = Port::State;
+
+    /** Default destructor */
+    ~QueuedInputPort() override = default;
+
+    /** @brief Construct with pointer to target object */
+    explicit QueuedInputPort(
+        T* target, OverflowPolicy policy = OverflowPolicy::Block);
+
+    /** @brief Construct with std::function target */
+    explicit QueuedInputPort(
+        std::function<void(T)> target,
+        OverflowPolicy policy = OverflowPolicy::Block);
+
+    /** @brief Construct with member function target */
+    template <class Obj, class ObjMemberFn>
+    QueuedInputPort(
+        Obj* obj,
+        ObjMemberFn&& fn,
+        OverflowPolicy policy = OverflowPolicy::Block);
+
+    /** Disable copy */
+    QueuedInputPort(const QueuedInputPort&) = delete;
+    /** Disable copy */
+    QueuedInputPort& operator=(const QueuedInputPort&) = delete;
+    /** Disable move */
+    QueuedInputPort(const QueuedInputPort&&) = delete;
+    /** Disable move */
+    QueuedInputPort& operator=(const QueuedInputPort&&) = delete;
+
+    /** @copydoc TypedInput::post(const Update<T>& u) */
+    using TypedInput<T>::post;
+
+    /**
+     * @brief Queue an update
+     *
+     * If the queue is full, the update is handled according to
+     * overflowPolicy().
+     */
+    void post(Update<T>&& u) override;
+
+    /** @copydoc post(Update<T>&& u) */
+    void post(T v);
+
+    /** @copydoc smgl::connect() */
+    QueuedInputPort& operator=(Output& op) override;
+
+    /** @brief Update the target with the oldest queued value */
+    bool update() override;
+
+    /** @brief Receive a state update from a connected port */
+    void notify(State s) override;
+
+    /** @brief Returns true if the queue is full */
+    auto full() const -> bool override;
+
+    /** @brief Get the number of queued values */
+    auto size() const -> std::size_t;
+
+    /** @brief Get the maximum number of queued values */
+    static constexpr auto capacity() -> std::size_t { return N; }
+
+    /** @brief Get the overflow policy */
+    auto overflowPolicy() const -> OverflowPolicy;
+
+    /**
+     * @brief Set the overflow policy
+     *
+     * Posts which are blocked on a full queue are released if the new policy
+     * is not OverflowPolicy::Block.
+     */
+    void setOverflowPolicy(OverflowPolicy policy);
+
+    /** @brief Get port metadata */
+    Metadata serialize() override;
+
+    /** @brief Load port metadata */
+    void deserialize(const Metadata& m) override;
+
+private:
+    /** Port target */
+    detail::PortTarget<T> target_;
+    /** Ring buffer of queued values */
+    std::array<T, N> queue_{};
+    /** Index of the oldest queued value */
+    std::size_t head_{0};
+    /** Number of queued values */
+    std::size_t size_{0};
+    /** Overflow policy */
+    OverflowPolicy policy_;
+    /** Queue lock */
+    mutable std::mutex mutex_;
+    /** Signaled when a value is consumed or the policy changes */
+    std::condition_variable space_;
+
+    /** @copydoc TypedInput::unchanged_() */
+    void unchanged_() override;
+};
+
+/**
+ * @brief InputPort which gathers the values of many OutputPorts
+ *
+ * Unlike other input ports, a GatherInputPort accepts any number of
+ * connections. It keeps the most recent value posted by each connected
+ * OutputPort and passes all of them to its target as a single std::vector,
+ * in the order the OutputPorts were connected. This allows a reduction Node
+ * to merge a number of parallel branches which is only known at runtime:
+ *
+ * ```{.cpp}
+ * class Sum : public Node {
+ *     std::vector<int> vals_;
+ * public:
+ *     GatherInputPort<int> values{&vals_};
+ *     ...
+ * };
+ *
+ * for (auto& branch : branches) {
+ *     connect(branch->result, sum->values);
+ * }
+ * ```
+ *
+ * Received values are moved into the gathered vector, so updating the port
+ * does not copy them. Function and member function targets receive the
+ * gathered vector by const reference. Pointer targets receive a copy; to
+ * avoid it, read the vector with values() instead.
+ *
+ * The port is Waiting until every connected OutputPort has posted a value and
+ * none of them are waiting on a new value. It is Queued when it is no longer
+ * waiting and at least one value changed since the last update(). Values
+ * must be posted by connected OutputPorts: calling post() directly throws
+ * smgl::bad_connection.
+ *
+ * @tparam T Type of object received from each connection
+ */
+template <typename T>
+class GatherInputPort : public TypedInput<T>
+{
+    static_assert(
+        std::is_copy_constructible<T>::value,
+        "GatherInputPort requires a copyable type");
+
+public:
+    /** Port state type */
+    using State = Port::State;
+    /** Type passed to the target */
+    using Values = std::vector<T>;
+
+    /** Destructor performs auto-disconnect */
+    ~GatherInputPort() override;
+
+    /** @brief Construct with pointer to target object */
+    explicit GatherInputPort(Values* target);
+
+    /** @brief Construct with std::function target */
+    explicit GatherInputPort(std::function<void(const Values&)> target);
+
+    /** @brief Construct with member function target */
+    template <class Obj, class ObjMemberFn>
+    GatherInputPort(Obj* obj, ObjMemberFn&& fn);
+
+    /** Disable copy */
+    GatherInputPort(const GatherInputPort&) = delete;
+    /** Disable copy */
+    GatherInputPort& operator=(const GatherInputPort&) = delete;
+    /** Disable move */
+    GatherInputPort(const GatherInputPort&&) = delete;
+    /** Disable move */
+    GatherInputPort& operator=(const GatherInputPort&&) = delete;
+
+    /** @copydoc TypedInput::post(const Update<T>& u) */
+    using TypedInput<T>::post;
+
+    /**
+     * @brief Not supported
+     *
+     * @throws smgl::bad_connection
+     */
+    void post(Update<T>&& u) override;
+
+    /** @copydoc smgl::connect() */
+    GatherInputPort& operator=(Output& op) override;
+
+    /** @brief Update the target with the values of all connections */
+    bool update() override;
+
+    /**
+     * @brief Get the values passed to the target by the last update()
+     *
+     * The reference is valid until the next update() or change of the port's
+     * connections.
+     */
+    auto values() const -> const Values&;
+
+    /** @brief Receive a state update for all connections */
+    void notify(State s) override;
+
+    /** @brief Get a list of port connections */
+    std::vector<Connection> getConnections() const override;
+
+    /** @brief Get the number of connections */
+    std::size_t numConnections() const override;
+
+    /** @brief Get port metadata */
+    Metadata serialize() override;
+
+    /** @brief Load port metadata */
+    void deserialize(const Metadata& m) override;
+
+private:
+    /** @brief Status of a connected OutputPort */
+    struct Source {
+        /** Connected port */
+        Output* port{nullptr};
+        /** Whether the port has posted a value */
+        bool received{false};
+        /** Whether the value changed since the last update() */
+        bool changed{false};
+        /** Whether the port is waiting on a new value */
+        bool waiting{false};
+    };
+
+    /** Pointer target. Receives a copy of gathered_. */
+    Values* ptr_{nullptr};
+    /** Function target. Receives gathered_ by reference. */
+    std::function<void(const Values&)> fn_;
+    /** Connected ports */
+    std::vector<Source> sources_;
+    /** Values received since the last update() */
+    Values values_;
+    /** Values passed to the target. Only modified by update(). */
+    Values gathered_;
+    /** Source and value lock */
+    mutable std::mutex mutex_;
+
+    /** Index of src in sources_ or sources_.size() */
+    auto find_(const Output* src) const -> std::size_t;
+    /** Set the port state from the status of all sources */
+    void refresh_();
+
+    /** @copydoc Input::add_source_() */
+    void add_source_(Output* op) override;
+    /** @copydoc Input::remove_source_() */
+    auto remove_source_(Output* op) -> bool override;
+
+    /** @copydoc TypedInput::unchanged_() */
+    void unchanged_() override;
+    /** @copydoc TypedInput::receive_() */
+    void receive_(Output* src, Update<T>&& u) override;
+    /** @copydoc TypedInput::receive_state_() */
+    void receive_state_(Output* src, State s) override;
+    /** @copydoc TypedInput::receive_unchanged_() */
+    void receive_unchanged_(Output* src) override;
 };
 
 /**
@@ -295,8 +868,8 @@ class OutputPort : public Output
 {
 public:
     /**
-     * If source_ is a function, a tuple storing a list of arguments that can
-     * be passed to source_
+     * If the source is a function, a tuple storing a list of arguments that
+     * can be passed to the source
      */
     using Arguments = std::tuple<Args...>;
 
@@ -345,14 +918,121 @@ public:
     /** @brief Get the number of active connections */
     std::size_t numConnections() const override;
 
+    /**
+     * @brief Returns true if any connected port is full
+     *
+     * A full port blocks or drops values posted by update(). See
+     * QueuedInputPort.
+     */
+    auto blocked() const -> bool override;
+
     /** @brief Set the arguments passed to a function source */
     void setArgs(Args&&... args);
 
+    /** Equality comparator type */
+    using Comparator = std::function<bool(const T&, const T&)>;
+
+    /**
+     * @brief Whether early cutoff is enabled
+     *
+     * @copydetails setEarlyCutoff()
+     */
+    auto earlyCutoff() const -> bool;
+
+    /**
+     * @brief Enable early cutoff using `operator==`
+     *
+     * When early cutoff is enabled, update() compares the value of the source
+     * against the most recently posted value. If they are equal, the value is
+     * not posted and connected InputPorts return to their previous state, so
+     * downstream Nodes are not recomputed. Disabled by default.
+     *
+     * While enabled, the port keeps a copy of the most recently posted value
+     * to compare against. For large payloads, use a Shared<T> port so that
+     * only the handle is kept.
+     */
+    void setEarlyCutoff(bool enable);
+
+    /**
+     * @brief Enable early cutoff using a custom equality comparator
+     *
+     * Passing an empty comparator disables early cutoff.
+     *
+     * @copydetails setEarlyCutoff()
+     */
+    void setComparator(Comparator eq);
+
+    /**
+     * @brief Whether update() moves the value out of a pointer source
+     *
+     * @copydetails setMoveSource()
+     */
+    auto moveSource() const -> bool;
+
+    /**
+     * @brief Move the value out of a pointer source on update()
+     *
+     * If enabled, the port was constructed with a pointer source, and the
+     * port has exactly one connection, update() moves the value out of the
+     * source instead of copying it. The value is then moved end-to-end from
+     * the source to the target of the connected InputPort, and the source is
+     * left in a moved-from state. Disabled by default.
+     *
+     * Always enabled if T is not copy constructible. Ports of move-only
+     * types only support a single connection, early cutoff is not available
+     * for them, and val() also moves the value out of a pointer source.
+     * Connecting them does not deliver the current value: the InputPort
+     * receives its first value on the next update().
+     */
+    void setMoveSource(bool enable);
+
+    /**
+     * @brief Whether function sources are evaluated lazily
+     *
+     * @copydetails setLazy()
+     */
+    auto lazy() const -> bool;
+
+    /**
+     * @brief Evaluate a function source only when its value is read
+     *
+     * In lazy mode, update() does not call the source. Connected InputPorts
+     * are marked as queued, and the source is called the first time one of
+     * them is updated, or when val() or ref() is called. The result is shared
+     * by all connections until the next update(). Use this for expensive
+     * outputs which are often not consumed. Disabled by default.
+     *
+     * Only function sources are evaluated lazily. Early cutoff is not applied
+     * to lazy ports since update() does not know the value. QueuedInputPort
+     * and GatherInputPort read the value as soon as it is posted. Since every
+     * read copies the shared result, T must be copy constructible. The lazy
+     * state is allocated when lazy mode is enabled.
+     *
+     * A pull evaluates the source with the state of the Node at the time it
+     * is read. Graph::stream() does not start a Node's next frame until
+     * every downstream Node has taken its inputs, so connected InputPorts
+     * read the frame which was posted. val() and ref() read the most recent
+     * frame.
+     */
+    void setLazy(bool enable);
+
     /** @brief Get the current value of source */
     T val();
     /** @brief Get the current value of source */
     T operator()();
 
+    /**
+     * @brief Get a const reference to the current value of source
+     *
+     * Does not copy pointer and constant sources. Function sources are
+     * evaluated and the result is cached in the port, so the reference is
+     * valid until the next call to ref(). The cached result of a lazy port
+     * is shared with its connections and is replaced when the source is
+     * evaluated after the next update(), so the reference must not be held
+     * across updates.
+     */
+    auto ref() -> const T&;
+
     /** @brief Update all active connections with the value of the source */
     bool update() override;
 
@@ -366,12 +1046,90 @@ public:
     void deserialize(const Metadata& m) override;
 
 private:
-    /** Value source */
-    std::function<T(Args...)> source_;
+    /** Calls a member function or std::function source */
+    using Invoker = T (*)(void*, const detail::MemberFnStorage&, Args...);
+    /**
+     * Source object of member function sources, owned std::function of
+     * function sources, or the T* of pointer sources. Null for constant
+     * sources.
+     */
+    void* obj_{nullptr};
+    /** Function source invoker. Null for pointer and constant sources. */
+    Invoker invoke_{nullptr};
+    /** Member function source */
+    detail::MemberFnStorage memberFn_{};
+
+    /** Source pointer if constructed with a pointer source, otherwise null */
+    auto source_ptr_() const -> T*;
+
+    /** Store a std::function source */
+    void set_function_(std::function<T(Args...)> fn);
+    /** Store a member function source inline */
+    template <class Obj, class Fn>
+    void set_member_(Obj* obj, Fn&& fn, std::true_type);
+    /** Store a member function source which does not fit inline */
+    template <class Obj, class Fn>
+    void set_member_(Obj* obj, Fn&& fn, std::false_type);
+    /** Invoker for member function sources */
+    template <class Obj, class Fn>
+    static auto InvokeMember_(
+        void* obj, const detail::MemberFnStorage& fn, Args... args) -> T;
+    /** Invoker for std::function sources */
+    static auto InvokeFunction_(
+        void* fn, const detail::MemberFnStorage& /*unused*/, Args... args)
+        -> T;
 
     /** If source is a function, the arguments passed to source */
     Arguments args_;
 
+    /** Constant source value or the cached value of a function source */
+    T cached_{};
+    /** Move from the pointer source on update() */
+    bool moveSource_{not std::is_copy_constructible<T>::value};
+
+    /** @brief Lazy evaluation state */
+    struct Lazy {
+        /** Serializes evaluation across consumers */
+        std::mutex mutex;
+        /** Result shared by every connection */
+        T value{};
+        /** Whether value must be recomputed before it is read */
+        bool stale{true};
+    };
+    /** Only allocated while lazy mode is enabled */
+    std::unique_ptr<Lazy> lazy_;
+
+    /** Whether update() defers evaluation to the consumers */
+    auto deferred_() const -> bool;
+    /** Post a deferred value to every connection */
+    auto update_lazy_() -> bool;
+    /** Get a deferred read of this port */
+    auto pull_() -> detail::Pull<T>;
+    /**
+     * Evaluate the source if the shared result is stale. Must hold
+     * lazy_->mutex.
+     */
+    auto evaluate_() -> T&;
+    /** Pull invoker */
+    static auto Read_(Output* port) -> T;
+
+    /** Returns true if early cutoff is enabled and v is unchanged */
+    auto cutoff_(const T& v, std::true_type) -> bool;
+    /** Early cutoff is unavailable for move-only types */
+    auto cutoff_(const T& v, std::false_type) -> bool;
+
+    /** Update connections of a copyable type */
+    auto update_(std::true_type) -> bool;
+    /** Update the connection of a move-only type */
+    auto update_(std::false_type) -> bool;
+    /** Signal every connection that the value did not change */
+    void post_unchanged_();
+
+    /** Post an update to every connection, copying as needed */
+    void post_(Update<T>&& u, std::true_type);
+    /** Move an update to the only connection */
+    void post_(Update<T>&& u, std::false_type);
+
     /** Get source value with arguments */
     template <std::size_t... Is>
     T run_(std::tuple<Args...>& tup, std::index_sequence<Is...>);
@@ -381,9 +1139,9 @@ private:
 
     /**
      * Connect to an input port. Uses RTTI to determine if ip is actually of
-     * type InputPort<T>.
+     * type TypedInput<T>.
      *
-     * @throws smgl::bad_connection if ip is not of type InputPort<T>
+     * @throws smgl::bad_connection if ip is not of type TypedInput<T>
      */
     void connect(Input* ip) final;
 
@@ -393,15 +1151,46 @@ private:
     /** @brief Describes typed connections from an output port */
     struct TypedConnection {
         /** Pointer to connected port's parent */
-        Node* node;
+        Node* node{nullptr};
         /** Pointer to connected port */
-        InputPort<T>* port;
+        TypedInput<T>* port{nullptr};
     };
 
-    /** Stores all outgoing connections */
-    std::unordered_map<Uuid, TypedConnection> connections_;
+    /** Returns the index of ip in connections_ or numConnections() */
+    auto find_(const Input* ip) const -> std::size_t;
+
+    /** Stores all outgoing connections contiguously */
+    detail::SmallVector<TypedConnection, detail::InlineConnections>
+        connections_;
+    /** Maps connected ports to their index in connections_ */
+    using ConnectionIndex = std::unordered_map<const Input*, std::size_t>;
+    /**
+     * Only allocated while there are more than
+     * detail::ConnectionIndexThreshold connections.
+     */
+    std::unique_ptr<ConnectionIndex> index_;
+
+    /** @brief Early cutoff state */
+    struct Cutoff {
+        /** Equality comparator */
+        Comparator equal;
+        /** Most recently posted value */
+        T last{};
+        /** Whether last has been posted to every connection */
+        bool hasLast{false};
+    };
+    /** Only allocated while early cutoff is enabled */
+    std::unique_ptr<Cutoff> earlyCutoff_;
 };
 
+/** @brief InputPort which receives an immutable, shared payload */
+template <typename T>
+using SharedInputPort = InputPort<Shared<T>>;
+
+/** @brief OutputPort which sends an immutable, shared payload */
+template <typename T, typename... Args>
+using SharedOutputPort = OutputPort<Shared<T>, Args...>;
+
 }  // namespace smgl
 
 #include "smgl/PortsImpl.hpp"
\ No newline at end of file
@@ -1,42 +1,271 @@
 namespace smgl
 {
 
+namespace detail
+{
+/** Copy a copyable value */
+template <typename T>
+auto CopyOrMove(T& v, std::true_type) -> T
+{
+    return v;
+}
+
+/** Move a move-only value */
+template <typename T>
+auto CopyOrMove(T& v, std::false_type) -> T
+{
+    return std::move(v);
+}
+
+/** Copy a value if T is copy constructible, otherwise move it */
+template <typename T>
+auto CopyOrMove(T& v) -> T
+{
+    return CopyOrMove(v, std::is_copy_constructible<T>{});
+}
+}  // namespace detail
+
+//////////////////////
+///// PortTarget /////
+//////////////////////
+
+namespace detail
+{
+template <typename T>
+PortTarget<T>::PortTarget(T* target) : target_{target}
+{
+}
+
+template <typename T>
+PortTarget<T>::PortTarget(std::function<void(T)> target)
+{
+    set_function_(std::move(target));
+}
+
+template <typename T>
+template <class Obj, class ObjMemberFn>
+PortTarget<T>::PortTarget(Obj* obj, ObjMemberFn&& fn)
+{
+    using Fn = std::decay_t<ObjMemberFn>;
+    set_member_(
+        obj, std::forward<ObjMemberFn>(fn), FitsMemberFnStorage<Fn>{});
+}
+
+template <typename T>
+PortTarget<T>::~PortTarget()
+{
+    if (invoke_ == &InvokeFunction_) {
+        delete static_cast<std::function<void(T)>*>(target_);
+    }
+}
+
+template <typename T>
+void PortTarget<T>::apply(T& v)
+{
+    if (invoke_) {
+        invoke_(target_, memberFn_, v);
+    } else {
+        *static_cast<T*>(target_) = std::move(v);
+    }
+}
+
+template <typename T>
+void PortTarget<T>::set_function_(std::function<void(T)> fn)
+{
+    target_ = new std::function<void(T)>(std::move(fn));
+    invoke_ = &InvokeFunction_;
+}
+
+template <typename T>
+template <class Obj, class Fn>
+void PortTarget<T>::set_member_(Obj* obj, Fn&& fn, std::true_type)
+{
+    using F = std::decay_t<Fn>;
+    new (memberFn_.bytes) F(std::forward<Fn>(fn));
+    target_ = obj;
+    invoke_ = &InvokeMember_<Obj, F>;
+}
+
+template <typename T>
+template <class Obj, class Fn>
+void PortTarget<T>::set_member_(Obj* obj, Fn&& fn, std::false_type)
+{
+    set_function_([obj, fn](T v) { (*obj.*fn)(std::move(v)); });
+}
+
+template <typename T>
+template <class Obj, class Fn>
+void PortTarget<T>::InvokeMember_(
+    void* obj, const MemberFnStorage& fn, T& v)
+{
+    const auto& f = *reinterpret_cast<const Fn*>(fn.bytes);
+    (static_cast<Obj*>(obj)->*f)(std::move(v));
+}
+
+template <typename T>
+void PortTarget<T>::InvokeFunction_(
+    void* fn, const MemberFnStorage& /*unused*/, T& v)
+{
+    (*static_cast<std::function<void(T)>*>(fn))(std::move(v));
+}
+}  // namespace detail
+
+//////////////////////
+///// TypedInput /////
+//////////////////////
+
+template <typename T>
+void TypedInput<T>::post(const Update<T>& u)
+{
+    post(Update<T>(u));
+}
+
+template <typename T>
+auto TypedInput<T>::full() const -> bool
+{
+    return false;
+}
+
+template <typename T>
+void TypedInput<T>::receive_(Output* /*src*/, Update<T>&& u)
+{
+    post(std::move(u));
+}
+
+template <typename T>
+void TypedInput<T>::receive_state_(Output* /*src*/, State s)
+{
+    this->notify(s);
+}
+
+template <typename T>
+void TypedInput<T>::receive_unchanged_(Output* /*src*/)
+{
+    unchanged_();
+}
+
+template <typename T>
+void TypedInput<T>::receive_lazy_(Output* src, detail::Pull<T> pull)
+{
+    receive_(src, Update<T>{pull()});
+}
+
 /////////////////////
 ///// InputPort /////
 /////////////////////
 
 // Must know what object will actually store posted values
 template <typename T>
-InputPort<T>::InputPort(T* target) : target_{[target](T v) { *target = v; }}
+InputPort<T>::InputPort(T* target) : target_{target}
 {
 }
 
 template <typename T>
-InputPort<T>::InputPort(std::function<void(T)> target) : target_{target}
+InputPort<T>::~InputPort()
+{
+    delete mailbox_.load();
+    delete spare_.load();
+}
+
+template <typename T>
+InputPort<T>::InputPort(std::function<void(T)> target)
+    : target_{std::move(target)}
 {
 }
 
 template <typename T>
 template <class Obj, class ObjMemberFn>
 InputPort<T>::InputPort(Obj* obj, ObjMemberFn&& fn)
-    : target_{[=](T v) { return (*obj.*fn)(v); }}
+    : target_{obj, std::forward<ObjMemberFn>(fn)}
 {
 }
 
 template <typename T>
 void InputPort<T>::post(const Update<T>& u)
 {
-    // TODO: Lock the queue
-    queued_update_ = u;
-    queued_update_.tick = last_updated_ + 1;
-    state_ = State::Queued;
+    post(Update<T>(u));
+}
+
+template <typename T>
+void InputPort<T>::post(Update<T>&& u)
+{
+    auto* slot = acquire_slot_();
+    slot->update = std::move(u);
+    slot->pull = {};
+    publish_(slot);
+}
+
+template <typename T>
+void InputPort<T>::receive_lazy_(Output* /*src*/, detail::Pull<T> pull)
+{
+    auto* slot = acquire_slot_();
+    slot->pull = pull;
+    publish_(slot);
+}
+
+template <typename T>
+auto InputPort<T>::remove_source_(Output* op) -> bool
+{
+    // The source cannot be read once it is disconnected
+    auto* slot = mailbox_.exchange(nullptr);
+    if (slot and slot->pull and slot->pull.port == op) {
+        slot->pull = {};
+        release_slot_(slot);
+        idle_();
+    } else if (slot) {
+        requeue_slot_(slot);
+    }
+    return Input::remove_source_(op);
+}
+
+template <typename T>
+void InputPort<T>::publish_(Slot* slot)
+{
+    slot->update.tick = this->last_updated_ + 1;
+    // Replaces any update which has not been consumed
+    release_slot_(mailbox_.exchange(slot));
+    this->setState(State::Queued);
+}
+
+template <typename T>
+auto InputPort<T>::acquire_slot_() -> Slot*
+{
+    auto* slot = spare_.exchange(nullptr);
+    return (slot) ? slot : new Slot;
+}
+
+template <typename T>
+void InputPort<T>::release_slot_(Slot* slot)
+{
+    if (slot) {
+        delete spare_.exchange(slot);
+    }
+}
+
+template <typename T>
+void InputPort<T>::requeue_slot_(Slot* slot)
+{
+    Slot* expected{nullptr};
+    if (not mailbox_.compare_exchange_strong(expected, slot)) {
+        release_slot_(slot);
+    }
+}
+
+template <typename T>
+void InputPort<T>::idle_()
+{
+    this->setState(State::Idle);
+    // A producer may have posted after the mailbox was emptied
+    if (mailbox_.load() != nullptr) {
+        this->setState(State::Queued);
+    }
 }
 
 // For testing purposes only
 template <typename T>
 void InputPort<T>::post(T v, bool immediate)
 {
-    post(Update<T>{v, 0});
+    post(Update<T>{std::move(v), 0});
     if (immediate) {
         update();
     }
@@ -51,13 +280,13 @@ void InputPort<T>::operator()(const Update<T>& u)
 template <typename T>
 void InputPort<T>::operator()(T v, bool immediate)
 {
-    post(v, immediate);
+    post(std::move(v), immediate);
 }
 
 template <typename T>
 auto InputPort<T>::operator=(T v) -> InputPort<T>&
 {
-    post(v, false);
+    post(std::move(v), false);
     return *this;
 }
 
@@ -72,28 +301,61 @@ auto InputPort<T>::operator=(Output& op) -> InputPort<T>&
 template <typename T>
 auto InputPort<T>::update() -> bool
 {
-    // TODO: Lock the queue
-    if (queued_update_.tick > last_updated_) {
-        target_(queued_update_.val);
-        last_updated_ = queued_update_.tick;
-        state_ = State::Idle;
-        return true;
+    auto* slot = mailbox_.exchange(nullptr);
+    if (not slot) {
+        // A producer marks the port Queued after publishing, which can be
+        // after a consumer has already taken and applied its update
+        if (this->state() == State::Queued) {
+            idle_();
+        }
+        return false;
     }
-    return false;
+
+    // Keep stale updates so that unchanged_() can restore them
+    if (slot->update.tick <= this->last_updated_) {
+        requeue_slot_(slot);
+        return false;
+    }
+
+    // Read deferred values from lazy sources
+    if (slot->pull) {
+        slot->update.val = slot->pull();
+        slot->pull = {};
+    }
+
+    // The mailbox has been emptied, so the value can be moved
+    target_.apply(slot->update.val);
+    release_slot_(slot);
+    idle_();
+    return true;
 }
 
 template <typename T>
 void InputPort<T>::notify(State s)
 {
-    last_updated_++;
-    state_ = s;
+    this->last_updated_++;
+    this->setState(s);
+}
+
+template <typename T>
+void InputPort<T>::unchanged_()
+{
+    auto* slot = mailbox_.exchange(nullptr);
+    if (not slot) {
+        this->last_updated_++;
+        idle_();
+    } else {
+        slot->update.tick = ++this->last_updated_ + 1;
+        requeue_slot_(slot);
+        this->setState(State::Queued);
+    }
 }
 
 template <typename T>
 auto InputPort<T>::serialize() -> Metadata
 {
     Metadata m;
-    m["uuid"] = uuid_.string();
+    m["uuid"] = this->uuid_.string();
     // TODO: STATUS
     return m;
 }
@@ -101,7 +363,364 @@ auto InputPort<T>::serialize() -> Metadata
 template <typename T>
 void InputPort<T>::deserialize(const Metadata& m)
 {
-    uuid_ = Uuid::FromString(m["uuid"].get<std::string>());
+    this->uuid_ = Uuid::FromString(m["uuid"].get<std::string>());
+}
+
+///////////////////////////
+///// QueuedInputPort /////
+///////////////////////////
+
+template <typename T, std::size_t N>
+QueuedInputPort<T, N>::QueuedInputPort(T* target, OverflowPolicy policy)
+    : target_{target}, policy_{policy}
+{
+}
+
+template <typename T, std::size_t N>
+QueuedInputPort<T, N>::QueuedInputPort(
+    std::function<void(T)> target, OverflowPolicy policy)
+    : target_{std::move(target)}, policy_{policy}
+{
+}
+
+template <typename T, std::size_t N>
+template <class Obj, class ObjMemberFn>
+QueuedInputPort<T, N>::QueuedInputPort(
+    Obj* obj, ObjMemberFn&& fn, OverflowPolicy policy)
+    : target_{obj, std::forward<ObjMemberFn>(fn)}, policy_{policy}
+{
+}
+
+template <typename T, std::size_t N>
+void QueuedInputPort<T, N>::post(Update<T>&& u)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (size_ == N) {
+        if (policy_ == OverflowPolicy::Block) {
+            space_.wait(lock, [this]() {
+                return size_ < N or policy_ != OverflowPolicy::Block;
+            });
+        }
+        if (size_ == N) {
+            if (policy_ == OverflowPolicy::DropNewest) {
+                return;
+            }
+            head_ = (head_ + 1) % N;
+            size_--;
+        }
+    }
+    queue_[(head_ + size_) % N] = std::move(u.val);
+    size_++;
+    this->setState(State::Queued);
+}
+
+template <typename T, std::size_t N>
+void QueuedInputPort<T, N>::post(T v)
+{
+    post(Update<T>{std::move(v), 0});
+}
+
+template <typename T, std::size_t N>
+auto QueuedInputPort<T, N>::operator=(Output& op) -> QueuedInputPort&
+{
+    Input::operator=(op);
+    return *this;
+}
+
+template <typename T, std::size_t N>
+auto QueuedInputPort<T, N>::update() -> bool
+{
+    T v;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (size_ == 0) {
+            return false;
+        }
+        v = std::move(queue_[head_]);
+        head_ = (head_ + 1) % N;
+        size_--;
+        this->setState((size_ > 0) ? State::Queued : State::Idle);
+    }
+    space_.notify_one();
+    target_.apply(v);
+    return true;
+}
+
+template <typename T, std::size_t N>
+void QueuedInputPort<T, N>::notify(State s)
+{
+    // Queued values are never invalidated by the source
+    std::lock_guard<std::mutex> lock(mutex_);
+    this->setState((s == State::Idle and size_ > 0) ? State::Queued : s);
+}
+
+template <typename T, std::size_t N>
+void QueuedInputPort<T, N>::unchanged_()
+{
+    notify(State::Idle);
+}
+
+template <typename T, std::size_t N>
+auto QueuedInputPort<T, N>::full() const -> bool
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_ == N;
+}
+
+template <typename T, std::size_t N>
+auto QueuedInputPort<T, N>::size() const -> std::size_t
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+template <typename T, std::size_t N>
+auto QueuedInputPort<T, N>::overflowPolicy() const -> OverflowPolicy
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return policy_;
+}
+
+template <typename T, std::size_t N>
+void QueuedInputPort<T, N>::setOverflowPolicy(OverflowPolicy policy)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        policy_ = policy;
+    }
+    space_.notify_all();
+}
+
+template <typename T, std::size_t N>
+auto QueuedInputPort<T, N>::serialize() -> Metadata
+{
+    Metadata m;
+    m["uuid"] = this->uuid_.string();
+    return m;
+}
+
+template <typename T, std::size_t N>
+void QueuedInputPort<T, N>::deserialize(const Metadata& m)
+{
+    this->uuid_ = Uuid::FromString(m["uuid"].get<std::string>());
+}
+
+///////////////////////////
+///// GatherInputPort /////
+///////////////////////////
+
+template <typename T>
+GatherInputPort<T>::GatherInputPort(Values* target) : ptr_{target}
+{
+}
+
+template <typename T>
+GatherInputPort<T>::GatherInputPort(
+    std::function<void(const Values&)> target)
+    : fn_{std::move(target)}
+{
+}
+
+template <typename T>
+template <class Obj, class ObjMemberFn>
+GatherInputPort<T>::GatherInputPort(Obj* obj, ObjMemberFn&& fn)
+    : fn_{[obj, f = std::forward<ObjMemberFn>(fn)](const Values& v) {
+        (obj->*f)(v);
+    }}
+{
+}
+
+template <typename T>
+GatherInputPort<T>::~GatherInputPort()
+{
+    for (const auto& src : sources_) {
+        this->release_(src.port);
+    }
+}
+
+template <typename T>
+void GatherInputPort<T>::post(Update<T>&& /*u*/)
+{
+    throw bad_connection(
+        "GatherInputPort only receives values from connected ports");
+}
+
+template <typename T>
+auto GatherInputPort<T>::operator=(Output& op) -> GatherInputPort&
+{
+    Input::operator=(op);
+    return *this;
+}
+
+template <typename T>
+auto GatherInputPort<T>::update() -> bool
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (this->state_ != State::Queued) {
+            return false;
+        }
+        // Unchanged values are already in gathered_
+        for (std::size_t idx = 0; idx < sources_.size(); idx++) {
+            if (sources_[idx].changed) {
+                gathered_[idx] = std::move(values_[idx]);
+                sources_[idx].changed = false;
+            }
+        }
+        refresh_();
+    }
+
+    // Sources only write to values_, so gathered_ can be read unlocked
+    if (ptr_) {
+        *ptr_ = gathered_;
+    } else if (fn_) {
+        fn_(gathered_);
+    }
+    return true;
+}
+
+template <typename T>
+auto GatherInputPort<T>::values() const -> const Values&
+{
+    return gathered_;
+}
+
+template <typename T>
+void GatherInputPort<T>::notify(State s)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& src : sources_) {
+        src.waiting = (s == State::Waiting);
+    }
+    refresh_();
+}
+
+template <typename T>
+auto GatherInputPort<T>::getConnections() const -> std::vector<Connection>
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Connection> cns;
+    cns.reserve(sources_.size());
+    for (const auto& src : sources_) {
+        cns.push_back(this->connection_(src.port));
+    }
+    return cns;
+}
+
+template <typename T>
+auto GatherInputPort<T>::numConnections() const -> std::size_t
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sources_.size();
+}
+
+template <typename T>
+auto GatherInputPort<T>::serialize() -> Metadata
+{
+    Metadata m;
+    m["uuid"] = this->uuid_.string();
+    return m;
+}
+
+template <typename T>
+void GatherInputPort<T>::deserialize(const Metadata& m)
+{
+    this->uuid_ = Uuid::FromString(m["uuid"].get<std::string>());
+}
+
+template <typename T>
+auto GatherInputPort<T>::find_(const Output* src) const -> std::size_t
+{
+    std::size_t idx{0};
+    for (; idx < sources_.size(); idx++) {
+        if (sources_[idx].port == src) {
+            break;
+        }
+    }
+    return idx;
+}
+
+template <typename T>
+void GatherInputPort<T>::refresh_()
+{
+    auto changed = false;
+    for (const auto& src : sources_) {
+        if (src.waiting or not src.received) {
+            this->setState(State::Waiting);
+            return;
+        }
+        changed |= src.changed;
+    }
+    this->setState((changed) ? State::Queued : State::Idle);
+}
+
+template <typename T>
+void GatherInputPort<T>::add_source_(Output* op)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (find_(op) == sources_.size()) {
+        sources_.push_back({op});
+        values_.emplace_back();
+        gathered_.emplace_back();
+        refresh_();
+    }
+}
+
+template <typename T>
+auto GatherInputPort<T>::remove_source_(Output* op) -> bool
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto idx = find_(op);
+    if (idx == sources_.size()) {
+        return false;
+    }
+    // Preserve connection order
+    sources_.erase(sources_.begin() + idx);
+    values_.erase(values_.begin() + idx);
+    gathered_.erase(gathered_.begin() + idx);
+    refresh_();
+    return true;
+}
+
+template <typename T>
+void GatherInputPort<T>::unchanged_()
+{
+    notify(State::Idle);
+}
+
+template <typename T>
+void GatherInputPort<T>::receive_(Output* src, Update<T>&& u)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    // OutputPort::connect() posts before Input::connect() adds the source
+    auto idx = find_(src);
+    if (idx == sources_.size()) {
+        sources_.push_back({src});
+        values_.emplace_back();
+        gathered_.emplace_back();
+    }
+    values_[idx] = std::move(u.val);
+    sources_[idx].received = true;
+    sources_[idx].changed = true;
+    sources_[idx].waiting = false;
+    refresh_();
+}
+
+template <typename T>
+void GatherInputPort<T>::receive_state_(Output* src, State s)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto idx = find_(src);
+    if (idx < sources_.size()) {
+        sources_[idx].waiting = (s == State::Waiting);
+        refresh_();
+    }
+}
+
+template <typename T>
+void GatherInputPort<T>::receive_unchanged_(Output* src)
+{
+    receive_state_(src, State::Idle);
 }
 
 //////////////////////
@@ -112,37 +731,87 @@ template <typename T, typename... Args>
 OutputPort<T, Args...>::~OutputPort()
 {
     for (auto& c : connections_) {
-        c.second.port->disconnect(this);
+        c.port->disconnect(this);
+    }
+    if (invoke_ == &InvokeFunction_) {
+        delete static_cast<std::function<T(Args...)>*>(obj_);
     }
 }
 
 // Object source: constant
 template <typename T, typename... Args>
-OutputPort<T, Args...>::OutputPort(T source)
-    : source_{[source](Args...) { return source; }}
+OutputPort<T, Args...>::OutputPort(T source) : cached_{std::move(source)}
 {
 }
 // Object source: pointer
 template <typename T, typename... Args>
-OutputPort<T, Args...>::OutputPort(T* source)
-    : source_{[source](Args...) { return *source; }}
-{
-}
+OutputPort<T, Args...>::OutputPort(T* source) : obj_{source} {}
 
-// Member fn source w/optional default arguments
+// Fn source w/optional default arguments
 template <typename T, typename... Args>
 OutputPort<T, Args...>::OutputPort(
     std::function<T(Args...)> source, Args&&... args)
-    : source_{source}, args_{Arguments(std::forward<Args>(args)...)}
+    : args_{Arguments(std::forward<Args>(args)...)}
 {
+    set_function_(std::move(source));
 }
 
+// Member fn source w/optional default arguments
 template <typename T, typename... Args>
 template <class Obj, class ObjMemberFn>
 OutputPort<T, Args...>::OutputPort(Obj* obj, ObjMemberFn&& fn, Args&&... args)
-    : source_{[=](Args... a) { return (*obj.*fn)(a...); }}
-    , args_{Arguments(std::forward<Args>(args)...)}
+    : args_{Arguments(std::forward<Args>(args)...)}
+{
+    using Fn = std::decay_t<ObjMemberFn>;
+    set_member_(
+        obj, std::forward<ObjMemberFn>(fn),
+        detail::FitsMemberFnStorage<Fn>{});
+}
+
+template <typename T, typename... Args>
+void OutputPort<T, Args...>::set_function_(std::function<T(Args...)> fn)
 {
+    obj_ = new std::function<T(Args...)>(std::move(fn));
+    invoke_ = &InvokeFunction_;
+}
+
+template <typename T, typename... Args>
+template <class Obj, class Fn>
+void OutputPort<T, Args...>::set_member_(Obj* obj, Fn&& fn, std::true_type)
+{
+    using F = std::decay_t<Fn>;
+    new (memberFn_.bytes) F(std::forward<Fn>(fn));
+    obj_ = obj;
+    invoke_ = &InvokeMember_<Obj, F>;
+}
+
+template <typename T, typename... Args>
+template <class Obj, class Fn>
+void OutputPort<T, Args...>::set_member_(Obj* obj, Fn&& fn, std::false_type)
+{
+    set_function_([obj, fn](Args... a) { return (*obj.*fn)(a...); });
+}
+
+template <typename T, typename... Args>
+template <class Obj, class Fn>
+auto OutputPort<T, Args...>::InvokeMember_(
+    void* obj, const detail::MemberFnStorage& fn, Args... args) -> T
+{
+    const auto& f = *reinterpret_cast<const Fn*>(fn.bytes);
+    return (static_cast<Obj*>(obj)->*f)(args...);
+}
+
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::InvokeFunction_(
+    void* fn, const detail::MemberFnStorage& /*unused*/, Args... args) -> T
+{
+    return (*static_cast<std::function<T(Args...)>*>(fn))(args...);
+}
+
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::source_ptr_() const -> T*
+{
+    return invoke_ ? nullptr : static_cast<T*>(obj_);
 }
 
 template <typename T, typename... Args>
@@ -152,7 +821,7 @@ auto OutputPort<T, Args...>::getConnections() const -> std::vector<Connection>
     std::vector<Connection> cns;
     for (const auto& c : connections_) {
         cns.emplace_back(
-            parent_, const_cast<ThisType*>(this), c.second.node, c.second.port);
+            parent_, const_cast<ThisType*>(this), c.node, c.port);
     }
     return cns;
 }
@@ -163,17 +832,158 @@ auto OutputPort<T, Args...>::numConnections() const -> size_t
     return connections_.size();
 }
 
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::blocked() const -> bool
+{
+    for (const auto& c : connections_) {
+        if (c.port->full()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 // Replace the default arguments
 template <typename T, typename... Args>
 void OutputPort<T, Args...>::setArgs(Args&&... args)
 {
     args_ = Arguments(std::forward<Args>(args)...);
 }
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::earlyCutoff() const -> bool
+{
+    return static_cast<bool>(earlyCutoff_);
+}
+
+template <typename T, typename... Args>
+void OutputPort<T, Args...>::setEarlyCutoff(bool enable)
+{
+    if (enable) {
+        setComparator(std::equal_to<T>());
+    } else {
+        setComparator(nullptr);
+    }
+}
+
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::moveSource() const -> bool
+{
+    return moveSource_;
+}
+
+template <typename T, typename... Args>
+void OutputPort<T, Args...>::setMoveSource(bool enable)
+{
+    moveSource_ = enable or not std::is_copy_constructible<T>::value;
+}
+
+template <typename T, typename... Args>
+void OutputPort<T, Args...>::setComparator(Comparator eq)
+{
+    if (eq) {
+        earlyCutoff_ = std::make_unique<Cutoff>();
+        earlyCutoff_->equal = std::move(eq);
+    } else {
+        earlyCutoff_.reset();
+    }
+}
+
 // Get the most recent value
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::lazy() const -> bool
+{
+    return static_cast<bool>(lazy_);
+}
+
+template <typename T, typename... Args>
+void OutputPort<T, Args...>::setLazy(bool enable)
+{
+    // Each connection and val() reads its own copy of the shared result
+    static_assert(
+        std::is_copy_constructible<T>::value,
+        "Lazy OutputPorts require a copyable type");
+    if (enable and not lazy_) {
+        lazy_ = std::make_unique<Lazy>();
+    } else if (not enable) {
+        lazy_.reset();
+    }
+}
+
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::deferred_() const -> bool
+{
+    return lazy_ and invoke_;
+}
+
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::update_lazy_() -> bool
+{
+    {
+        std::lock_guard<std::mutex> lock(lazy_->mutex);
+        lazy_->stale = true;
+    }
+    for (const auto& c : connections_) {
+        c.port->receive_lazy_(this, pull_());
+    }
+    return connections_.size() > 0;
+}
+
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::pull_() -> detail::Pull<T>
+{
+    return {this, &Read_};
+}
+
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::evaluate_() -> T&
+{
+    if (lazy_->stale) {
+        lazy_->value = run_(args_);
+        lazy_->stale = false;
+    }
+    return lazy_->value;
+}
+
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::Read_(Output* port) -> T
+{
+    auto* p = static_cast<OutputPort<T, Args...>*>(port);
+    // Lazy mode was disabled after this pull was posted
+    if (not p->lazy_) {
+        return p->run_(p->args_);
+    }
+    // Copy before releasing the lock. Never moves: setLazy() is only
+    // available for copyable types.
+    std::lock_guard<std::mutex> lock(p->lazy_->mutex);
+    return detail::CopyOrMove(p->evaluate_());
+}
+
 template <typename T, typename... Args>
 auto OutputPort<T, Args...>::val() -> T
 {
-    return run_(args_);
+    if (deferred_()) {
+        return Read_(this);
+    } else if (auto* ptr = source_ptr_()) {
+        return detail::CopyOrMove(*ptr);
+    } else if (invoke_) {
+        return run_(args_);
+    } else {
+        return detail::CopyOrMove(cached_);
+    }
+}
+
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::ref() -> const T&
+{
+    if (deferred_()) {
+        std::lock_guard<std::mutex> lock(lazy_->mutex);
+        return evaluate_();
+    } else if (auto* ptr = source_ptr_()) {
+        return *ptr;
+    } else if (invoke_) {
+        cached_ = run_(args_);
+    }
+    return cached_;
 }
 template <typename T, typename... Args>
 auto OutputPort<T, Args...>::operator()() -> T
@@ -186,18 +996,120 @@ auto OutputPort<T, Args...>::operator()() -> T
 template <typename T, typename... Args>
 auto OutputPort<T, Args...>::update() -> bool
 {
-    Update<T> update{val()};
-    for (const auto& c : connections_) {
-        c.second.port->post(update);
+    using Copyable = std::is_copy_constructible<T>;
+
+    // Consumers evaluate lazy sources on demand
+    if (deferred_()) {
+        return update_lazy_();
+    }
+
+    // Move out of the source if it only has one consumer. Compare first so
+    // that unchanged values are left in the source.
+    auto* ptr = source_ptr_();
+    if (ptr and moveSource_ and connections_.size() == 1) {
+        if (cutoff_(*ptr, Copyable{})) {
+            post_unchanged_();
+            return false;
+        }
+        Update<T> update;
+        update.val = std::move(*ptr);
+        post_(std::move(update), Copyable{});
+        return true;
+    }
+
+    return update_(Copyable{});
+}
+
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::update_(std::true_type) -> bool
+{
+    if (invoke_) {
+        // Function results are temporaries which can be moved
+        Update<T> update{run_(args_)};
+        if (cutoff_(update.val, std::true_type{})) {
+            post_unchanged_();
+            return false;
+        }
+        post_(std::move(update), std::true_type{});
+    } else {
+        // Read other sources by reference so that unchanged values are never
+        // copied
+        const auto& v = ref();
+        if (cutoff_(v, std::true_type{})) {
+            post_unchanged_();
+            return false;
+        }
+        for (const auto& c : connections_) {
+            c.port->receive_(this, Update<T>{v});
+        }
     }
     return connections_.size() > 0;
 }
 
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::update_(std::false_type) -> bool
+{
+    post_(Update<T>{val()}, std::false_type{});
+    return connections_.size() > 0;
+}
+
+template <typename T, typename... Args>
+void OutputPort<T, Args...>::post_unchanged_()
+{
+    for (const auto& c : connections_) {
+        c.port->receive_unchanged_(this);
+    }
+}
+
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::cutoff_(const T& v, std::true_type) -> bool
+{
+    if (not earlyCutoff_) {
+        return false;
+    }
+    auto& c = *earlyCutoff_;
+    if (c.hasLast and c.equal(c.last, v)) {
+        return true;
+    }
+    c.last = v;
+    c.hasLast = true;
+    return false;
+}
+
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::cutoff_(const T& /*v*/, std::false_type) -> bool
+{
+    return false;
+}
+
+template <typename T, typename... Args>
+void OutputPort<T, Args...>::post_(Update<T>&& u, std::true_type)
+{
+    // Copy to all but the last connection, which receives the original
+    auto remaining = connections_.size();
+    for (const auto& c : connections_) {
+        if (--remaining > 0) {
+            c.port->receive_(this, Update<T>(u));
+        } else {
+            c.port->receive_(this, std::move(u));
+        }
+    }
+}
+
+template <typename T, typename... Args>
+void OutputPort<T, Args...>::post_(Update<T>&& u, std::false_type)
+{
+    // Move-only ports have at most one connection
+    for (const auto& c : connections_) {
+        c.port->receive_(this, std::move(u));
+    }
+}
+
 template <typename T, typename... Args>
 void OutputPort<T, Args...>::notify(State s)
 {
     for (const auto& c : connections_) {
-        c.second.port->notify(s);
+        c.port->receive_state_(this, s);
     }
 }
 
@@ -221,7 +1133,7 @@ template <std::size_t... Is>
 auto OutputPort<T, Args...>::run_(
     std::tuple<Args...>& tup, std::index_sequence<Is...>) -> T
 {
-    return source_(std::get<Is>(tup)...);
+    return invoke_(obj_, memberFn_, std::get<Is>(tup)...);
 }
 
 template <typename T, typename... Args>
@@ -230,25 +1142,84 @@ auto OutputPort<T, Args...>::run_(std::tuple<Args...>& tup) -> T
     return run_(tup, std::index_sequence_for<Args...>{});
 }
 
+template <typename T, typename... Args>
+auto OutputPort<T, Args...>::find_(const Input* ip) const -> std::size_t
+{
+    if (index_) {
+        auto it = index_->find(ip);
+        return (it == index_->end()) ? connections_.size() : it->second;
+    }
+    std::size_t idx{0};
+    for (; idx < connections_.size(); idx++) {
+        if (connections_[idx].port == ip) {
+            break;
+        }
+    }
+    return idx;
+}
+
 template <typename T, typename... Args>
 void OutputPort<T, Args...>::connect(Input* ip)
 {
-    if (typeid(*ip) != typeid(InputPort<T>)) {
+    auto typedIP = dynamic_cast<TypedInput<T>*>(ip);
+    if (not typedIP) {
         throw bad_connection("Ports not of same type");
     }
-    auto typedIP = static_cast<InputPort<T>*>(ip);
-    connections_[ip->uuid()] = {ip->parent_, typedIP};
-    if (state_ == State::Idle) {
-        Update<T> update{val()};
-        typedIP->post(update);
+    auto idx = find_(ip);
+    auto connected = idx < connections_.size();
+    if (not std::is_copy_constructible<T>::value and
+        not connections_.empty() and not connected) {
+        throw bad_connection("Move-only ports support a single connection");
+    }
+    if (connected) {
+        connections_[idx] = {ip->parent_, typedIP};
+    } else {
+        connections_.push_back({ip->parent_, typedIP});
+        if (connections_.size() > detail::ConnectionIndexThreshold) {
+            if (not index_) {
+                index_ = std::make_unique<ConnectionIndex>();
+                for (std::size_t i = 0; i < connections_.size(); i++) {
+                    (*index_)[connections_[i].port] = i;
+                }
+            } else {
+                (*index_)[ip] = idx;
+            }
+        }
+    }
+    // New connections have not received the last value
+    if (earlyCutoff_) {
+        earlyCutoff_->hasLast = false;
+    }
+    // Delivering a move-only value here would empty the source before its
+    // next update()
+    if (not std::is_copy_constructible<T>::value) {
+        return;
+    }
+    if (state_ == State::Idle and deferred_()) {
+        typedIP->receive_lazy_(this, pull_());
+    } else if (state_ == State::Idle) {
+        typedIP->receive_(this, Update<T>{val()});
     }
 }
 
 template <typename T, typename... Args>
 void OutputPort<T, Args...>::disconnect(Input* ip)
 {
-    if (connections_.erase(ip->uuid()) == 0) {
+    auto idx = find_(ip);
+    if (idx == connections_.size()) {
         // TODO: Throw error?
+        return;
+    }
+
+    // The last connection is swapped into the removed slot
+    connections_.erase(idx);
+    if (connections_.size() <= detail::ConnectionIndexThreshold) {
+        index_.reset();
+    } else {
+        index_->erase(ip);
+        if (idx < connections_.size()) {
+            (*index_)[connections_[idx].port] = idx;
+        }
     }
 }
 
@@ -2,9 +2,11 @@
 
 /** @file */
 
+#include <atomic>
 #include <cassert>
 #include <exception>
 #include <functional>
+#include <mutex>
 
 namespace smgl
 {
@@ -97,6 +99,37 @@ struct SingleThreaded {
         explicit Lock(T& /* unused */) {}
     };
 };
+
+/**
+ * @brief Threading policy which serializes access with a single class-level
+ * mutex
+ */
+template <typename T>
+class ClassLevelLockable
+{
+public:
+    /** Underlying type */
+    using VolatileType = T;
+    /** @brief Lock which holds the class-level mutex */
+    struct Lock {
+        /** Lock the class-level mutex */
+        Lock() : guard_{Mutex()} {}
+        /** Lock the class-level mutex */
+        explicit Lock(T& /* unused */) : guard_{Mutex()} {}
+
+    private:
+        /** Lock guard */
+        std::lock_guard<std::mutex> guard_;
+    };
+
+private:
+    /** Class-level mutex */
+    static auto Mutex() -> std::mutex&
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+};
 }  // namespace policy
 
 namespace detail
@@ -140,7 +173,7 @@ private:
     /** Destroys the wrapped singleton object */
     static void DestroySingleton();
     /** Pointer to the Singleton instance */
-    static InstanceType* instance_;
+    static std::atomic<InstanceType*> instance_;
     /** Whether the Singleton has been destroyed */
     static bool destroyed_;
 };
@@ -12,8 +12,8 @@ template <
     template <class> class M
 >
 // clang-format on
-typename SingletonHolder<T, C, L, M>::InstanceType*
-    SingletonHolder<T, C, L, M>::instance_ = nullptr;
+std::atomic<typename SingletonHolder<T, C, L, M>::InstanceType*>
+    SingletonHolder<T, C, L, M>::instance_{nullptr};
 
 /* Initialize the destroyed boolean */
 // clang-format off
@@ -38,22 +38,25 @@ template <
 T& SingletonHolder<T, C, L, M>::Instance()
 {
     // If we don't have an instance
-    if (!instance_) {
+    auto* instance = instance_.load(std::memory_order_acquire);
+    if (!instance) {
         // Use the threading model to get a lock
         [[maybe_unused]] typename M<T>::Lock guard;
         // Double-checked locking pattern
-        if (!instance_) {
+        instance = instance_.load(std::memory_order_relaxed);
+        if (!instance) {
             // Handle the singleton already being destroyed
             if (destroyed_) {
                 destroyed_ = false;
                 L<T>::OnDeadReference();
             }
             // Construct the singleton
-            instance_ = C<T>::Create();
+            instance = C<T>::Create();
+            instance_.store(instance, std::memory_order_release);
             L<T>::ScheduleDestruction(&DestroySingleton);
         }
     }
-    return *instance_;
+    return *instance;
 }
 
 /* Instance destruction implementation */
@@ -69,7 +72,7 @@ void SingletonHolder<T, C, L, M>::
 DestroySingleton()
 {
     assert(!destroyed_);
-    C<T>::Destroy(instance_);
+    C<T>::Destroy(instance_.load());
     instance_ = nullptr;
     destroyed_ = true;
 }
@@ -0,0 +1,100 @@
+#pragma once
+
+/** @file */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace smgl
+{
+
+/**
+ * @brief Work-stealing thread pool
+ *
+ * Each worker thread owns a task queue. Tasks submitted from a worker thread
+ * are pushed onto that worker's queue and are popped in LIFO order, which
+ * keeps dependent work on a warm cache. Tasks submitted from outside the pool
+ * are distributed round-robin across the workers. Idle workers steal from the
+ * front of the other workers' queues.
+ *
+ * Submitted tasks must not throw. Callers which need to report errors should
+ * capture them inside the task (e.g. with std::exception_ptr).
+ *
+ * ```{.cpp}
+ * smgl::ThreadPool pool(4);
+ * pool.submit([]() { doWork(); });
+ * ```
+ */
+class ThreadPool
+{
+public:
+    /** Task type */
+    using Task = std::function<void()>;
+
+    /**
+     * @brief Construct a pool with the given number of worker threads
+     *
+     * If `numThreads == 0`, DefaultThreadCount() workers are created.
+     */
+    explicit ThreadPool(std::size_t numThreads = 0);
+
+    /** Disable copy */
+    ThreadPool(const ThreadPool&) = delete;
+    /** Disable copy */
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /** @brief Finishes all queued tasks and joins the worker threads */
+    ~ThreadPool();
+
+    /** @brief Get the number of worker threads */
+    auto size() const -> std::size_t;
+
+    /** @brief Queue a task for execution */
+    void submit(Task task);
+
+    /**
+     * @brief Returns the number of hardware threads or 1 if it cannot be
+     * determined
+     */
+    static auto DefaultThreadCount() -> std::size_t;
+
+private:
+    /** Per-worker task queue */
+    struct WorkQueue {
+        /** Queue lock */
+        std::mutex mutex;
+        /** Queued tasks */
+        std::deque<Task> tasks;
+    };
+
+    /** Worker thread main loop */
+    void run_(std::size_t idx);
+    /** Pop a task from the back of the worker's own queue */
+    auto pop_(std::size_t idx, Task& task) -> bool;
+    /** Steal a task from the front of another worker's queue */
+    auto steal_(std::size_t idx, Task& task) -> bool;
+
+    /** Worker queues */
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    /** Worker threads */
+    std::vector<std::thread> workers_;
+    /** Number of queued, unclaimed tasks */
+    std::atomic<std::size_t> pending_{0};
+    /** Round-robin index for external submissions */
+    std::atomic<std::size_t> next_{0};
+    /** Sleep/wake lock */
+    std::mutex mutex_;
+    /** Sleep/wake condition */
+    std::condition_variable cv_;
+    /** Shutdown flag */
+    bool stop_{false};
+};
+
+}  // namespace smgl
@@ -2,7 +2,12 @@
 
 /** @file */
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace smgl
 {
@@ -51,6 +56,68 @@ struct ExpandType {
     explicit ExpandType(T&&...);
 };
 
+/**
+ * @brief Contiguous vector which stores up to N elements inline
+ *
+ * Elements are kept in an inline array until the size exceeds N, at which
+ * point they are moved to the heap. Iteration is always over a single
+ * contiguous range. erase() swaps the removed element with the last element,
+ * so element order is not preserved.
+ */
+template <typename T, std::size_t N>
+class SmallVector
+{
+public:
+    /** Iterator type */
+    using iterator = T*;
+    /** Const iterator type */
+    using const_iterator = const T*;
+
+    /** @brief Get the number of elements */
+    auto size() const -> std::size_t;
+    /** @brief Returns true if there are no elements */
+    auto empty() const -> bool;
+
+    /** @brief Access an element */
+    auto operator[](std::size_t idx) -> T&;
+    /** @brief Access an element */
+    auto operator[](std::size_t idx) const -> const T&;
+
+    /** @brief Get a pointer to the first element */
+    auto data() -> T*;
+    /** @brief Get a pointer to the first element */
+    auto data() const -> const T*;
+
+    /** @brief Iterator to the first element */
+    auto begin() -> iterator;
+    /** @brief Iterator past the last element */
+    auto end() -> iterator;
+    /** @brief Iterator to the first element */
+    auto begin() const -> const_iterator;
+    /** @brief Iterator past the last element */
+    auto end() const -> const_iterator;
+
+    /** @brief Append an element */
+    void push_back(const T& v);
+    /** @brief Remove an element by swapping it with the last element */
+    void erase(std::size_t idx);
+    /** @brief Remove all elements and return to inline storage */
+    void clear();
+
+private:
+    /** Inline storage */
+    std::array<T, N> inline_{};
+    /** Heap storage, used once the size has exceeded N */
+    std::unique_ptr<T[]> heap_;
+    /** Number of elements */
+    std::uint32_t size_{0};
+    /** Number of elements which fit in the current storage */
+    std::uint32_t capacity_{N};
+
+    /** Move the elements to a larger heap allocation */
+    void grow_();
+};
+
 }  // namespace detail
 }  // namespace smgl
 
@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <cstdlib>
 #include <memory>
+#include <utility>
 #include <typeinfo>
 #include <cxxabi.h>
 
@@ -31,5 +33,107 @@ ExpandType::ExpandType(T&&...)
 {
 }
 
+template <typename T, std::size_t N>
+auto SmallVector<T, N>::size() const -> std::size_t
+{
+    return size_;
+}
+
+template <typename T, std::size_t N>
+auto SmallVector<T, N>::empty() const -> bool
+{
+    return size_ == 0;
+}
+
+template <typename T, std::size_t N>
+auto SmallVector<T, N>::operator[](std::size_t idx) -> T&
+{
+    return data()[idx];
+}
+
+template <typename T, std::size_t N>
+auto SmallVector<T, N>::operator[](std::size_t idx) const -> const T&
+{
+    return data()[idx];
+}
+
+template <typename T, std::size_t N>
+auto SmallVector<T, N>::data() -> T*
+{
+    return heap_ ? heap_.get() : inline_.data();
+}
+
+template <typename T, std::size_t N>
+auto SmallVector<T, N>::data() const -> const T*
+{
+    return heap_ ? heap_.get() : inline_.data();
+}
+
+template <typename T, std::size_t N>
+auto SmallVector<T, N>::begin() -> iterator
+{
+    return data();
+}
+
+template <typename T, std::size_t N>
+auto SmallVector<T, N>::end() -> iterator
+{
+    return data() + size_;
+}
+
+template <typename T, std::size_t N>
+auto SmallVector<T, N>::begin() const -> const_iterator
+{
+    return data();
+}
+
+template <typename T, std::size_t N>
+auto SmallVector<T, N>::end() const -> const_iterator
+{
+    return data() + size_;
+}
+
+template <typename T, std::size_t N>
+void SmallVector<T, N>::push_back(const T& v)
+{
+    if (size_ == capacity_) {
+        grow_();
+    }
+    data()[size_++] = v;
+}
+
+template <typename T, std::size_t N>
+void SmallVector<T, N>::erase(std::size_t idx)
+{
+    auto last = size_ - 1;
+    if (idx != last) {
+        data()[idx] = std::move(data()[last]);
+    }
+    data()[last] = T{};
+    size_--;
+}
+
+template <typename T, std::size_t N>
+void SmallVector<T, N>::clear()
+{
+    inline_.fill(T{});
+    heap_.reset();
+    size_ = 0;
+    capacity_ = N;
+}
+
+template <typename T, std::size_t N>
+void SmallVector<T, N>::grow_()
+{
+    auto capacity = 2 * capacity_ + 1;
+    auto heap = std::make_unique<T[]>(capacity);
+    std::move(begin(), end(), heap.get());
+    if (not heap_) {
+        inline_.fill(T{});
+    }
+    heap_ = std::move(heap);
+    capacity_ = capacity;
+}
+
 }  // namespace detail
 }  // namespace smgl
@@ -3,6 +3,7 @@
 /** @file */
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -51,6 +52,14 @@ public:
      */
     auto short_string() const -> std::string;
 
+    /**
+     * @brief Get a hash of the UUID bytes
+     *
+     * Folds the 16 bytes into a std::size_t without building the string
+     * representation.
+     */
+    auto hash() const noexcept -> std::size_t;
+
     /**
      * @brief Construct a UUID from a string
      *
@@ -98,7 +107,7 @@ struct hash<smgl::Uuid> {
     /** Hash Uuid */
     auto operator()(smgl::Uuid const& u) const noexcept -> std::size_t
     {
-        return std::hash<std::string>{}(u.string());
+        return u.hash();
     }
 };
 }  // namespace std
\ No newline at end of file
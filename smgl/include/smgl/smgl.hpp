@@ -1,10 +1,13 @@
 #pragma once
 
+#include "smgl/Buffer.hpp"
+#include "smgl/CacheWriter.hpp"
 #include "smgl/Graph.hpp"
 #include "smgl/Logging.hpp"
 #include "smgl/Metadata.hpp"
 #include "smgl/Node.hpp"
 #include "smgl/Ports.hpp"
+#include "smgl/ThreadPool.hpp"
 #include "smgl/Utilities.hpp"
 #include "smgl/Uuid.hpp"
 #include "smgl/filesystem.hpp"
@@ -0,0 +1,216 @@
+#include "smgl/Buffer.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace smgl;
+using namespace smgl::detail;
+
+namespace
+{
+// Size of a huge page on common platforms
+constexpr std::size_t HugePageSize{2 * 1024 * 1024};
+
+auto ErrorMessage(const std::string& what, const filesystem::path& path)
+    -> std::string
+{
+    return what + " " + path.string() + ": " + std::strerror(errno);
+}
+
+// Closes a file descriptor when it goes out of scope
+struct FileDescriptor {
+    int fd{-1};
+    ~FileDescriptor()
+    {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+
+void WriteAll(int fd, const void* data, std::size_t bytes)
+{
+    auto ptr = static_cast<const char*>(data);
+    while (bytes > 0) {
+        auto written = ::write(fd, ptr, bytes);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(
+                std::string("Failed to write buffer: ") + std::strerror(errno));
+        }
+        ptr += written;
+        bytes -= static_cast<std::size_t>(written);
+    }
+}
+}  // namespace
+
+auto BufferBlock::Allocate(std::size_t bytes) -> std::shared_ptr<BufferBlock>
+{
+    std::shared_ptr<BufferBlock> block(new BufferBlock);
+    if (bytes == 0) {
+        return block;
+    }
+    void* data{nullptr};
+    if (::posix_memalign(&data, BufferAlignment, bytes) != 0) {
+        throw std::bad_alloc();
+    }
+    block->data_ = data;
+    block->bytes_ = bytes;
+    return block;
+}
+
+auto BufferBlock::AllocateHugePages(std::size_t bytes)
+    -> std::shared_ptr<BufferBlock>
+{
+    std::shared_ptr<BufferBlock> block(new BufferBlock);
+    block->storage_ = BufferStorage::HugePages;
+    if (bytes == 0) {
+        return block;
+    }
+
+    void* data{MAP_FAILED};
+    auto prot = PROT_READ | PROT_WRITE;
+    auto flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+    // Explicit huge pages need a reserved pool and a rounded size
+    auto rounded = (bytes + HugePageSize - 1) / HugePageSize * HugePageSize;
+    data = ::mmap(nullptr, rounded, prot, flags | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+        bytes = rounded;
+    }
+#endif
+    if (data == MAP_FAILED) {
+        data = ::mmap(nullptr, bytes, prot, flags, -1, 0);
+        if (data == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+#ifdef MADV_HUGEPAGE
+        // Fall back to transparent huge pages
+        ::madvise(data, bytes, MADV_HUGEPAGE);
+#endif
+    }
+    block->data_ = data;
+    block->bytes_ = bytes;
+    return block;
+}
+
+auto BufferBlock::MapFile(
+    const filesystem::path& path, std::size_t bytes, bool resize)
+    -> std::shared_ptr<BufferBlock>
+{
+    auto flags = (resize) ? O_RDWR | O_CREAT : O_RDWR;
+    auto block = Map_(path, bytes, resize, flags, MAP_SHARED);
+    block->shared_ = true;
+    return block;
+}
+
+auto BufferBlock::MapFilePrivate(const filesystem::path& path)
+    -> std::shared_ptr<BufferBlock>
+{
+    return Map_(path, 0, false, O_RDONLY, MAP_PRIVATE);
+}
+
+auto BufferBlock::Map_(
+    const filesystem::path& path,
+    std::size_t bytes,
+    bool resize,
+    int openFlags,
+    int mapFlags) -> std::shared_ptr<BufferBlock>
+{
+    std::shared_ptr<BufferBlock> block(new BufferBlock);
+    block->storage_ = BufferStorage::File;
+    block->path_ = path;
+
+    FileDescriptor file;
+    file.fd = ::open(path.c_str(), openFlags, 0644);
+    if (file.fd < 0) {
+        throw std::runtime_error(ErrorMessage("Failed to open", path));
+    }
+
+    if (resize) {
+        constexpr auto maxBytes = std::numeric_limits<off_t>::max();
+        if (bytes > static_cast<std::size_t>(maxBytes)) {
+            throw std::length_error("Buffer is too large for a file");
+        }
+        if (::ftruncate(file.fd, static_cast<off_t>(bytes)) != 0) {
+            throw std::runtime_error(ErrorMessage("Failed to resize", path));
+        }
+    } else {
+        struct stat st {
+        };
+        if (::fstat(file.fd, &st) != 0) {
+            throw std::runtime_error(ErrorMessage("Failed to stat", path));
+        }
+        bytes = static_cast<std::size_t>(st.st_size);
+    }
+
+    // Page-aligned maps are always BufferAlignment aligned. Private maps are
+    // writable even though the file is not.
+    if (bytes > 0) {
+        auto data = ::mmap(
+            nullptr, bytes, PROT_READ | PROT_WRITE, mapFlags, file.fd, 0);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error(ErrorMessage("Failed to map", path));
+        }
+        block->data_ = data;
+        block->bytes_ = bytes;
+    }
+    return block;
+}
+
+BufferBlock::~BufferBlock()
+{
+    if (data_ == nullptr) {
+        return;
+    }
+    if (storage_ == BufferStorage::Heap) {
+        std::free(data_);
+    } else {
+        ::munmap(data_, bytes_);
+    }
+}
+
+auto BufferBlock::data() const -> void* { return data_; }
+
+auto BufferBlock::bytes() const -> std::size_t { return bytes_; }
+
+auto BufferBlock::storage() const -> BufferStorage { return storage_; }
+
+auto BufferBlock::path() const -> const filesystem::path& { return path_; }
+
+auto BufferBlock::sharedFile() const -> bool { return shared_; }
+
+void BufferBlock::sync() const
+{
+    if (shared_ and data_ != nullptr) {
+        ::msync(data_, bytes_, MS_SYNC);
+    }
+}
+
+void smgl::detail::WriteBytes(
+    const filesystem::path& path, const void* data, std::size_t bytes)
+{
+    auto tmp = path;
+    tmp += ".tmp";
+    {
+        FileDescriptor file;
+        file.fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (file.fd < 0) {
+            throw std::runtime_error(ErrorMessage("Failed to open", tmp));
+        }
+        WriteAll(file.fd, data, bytes);
+    }
+    filesystem::rename(tmp, path);
+}
@@ -0,0 +1,81 @@
+#include "smgl/CacheWriter.hpp"
+
+#include <algorithm>
+
+using namespace smgl;
+
+// Must declare const static member in cpp
+// https://stackoverflow.com/a/53350948
+#if __cplusplus < 201703L
+constexpr std::size_t CacheWriter::DefaultCapacity;
+#endif
+
+CacheWriter::CacheWriter(std::size_t capacity)
+    : capacity_{std::max<std::size_t>(capacity, 1)}
+    , thread_{&CacheWriter::run_, this}
+{
+}
+
+CacheWriter::~CacheWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    queued_.notify_all();
+    thread_.join();
+}
+
+auto CacheWriter::capacity() const -> std::size_t { return capacity_; }
+
+void CacheWriter::submit(Task task)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        progress_.wait(lock, [this]() { return tasks_.size() < capacity_; });
+        tasks_.emplace_back(std::move(task));
+    }
+    queued_.notify_one();
+}
+
+void CacheWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    progress_.wait(lock, [this]() { return tasks_.empty() and not busy_; });
+    if (error_) {
+        auto error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void CacheWriter::run_()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        queued_.wait(lock, [this]() { return stop_ or not tasks_.empty(); });
+        if (tasks_.empty()) {
+            return;
+        }
+        auto task = std::move(tasks_.front());
+        tasks_.pop_front();
+        busy_ = true;
+        progress_.notify_all();
+
+        lock.unlock();
+        std::exception_ptr error;
+        try {
+            task();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        task = nullptr;
+        lock.lock();
+
+        if (error and not error_) {
+            error_ = error;
+        }
+        busy_ = false;
+        progress_.notify_all();
+    }
+}
@@ -1,6 +1,14 @@
 #include "smgl/Graph.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
 #include <functional>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <unordered_set>
 
 #include "smgl/LoggingPrivate.hpp"
 #include "smgl/Metadata.hpp"
@@ -24,6 +32,385 @@ inline auto CacheDir(const fs::path& json, CacheType t) -> fs::path
     return json.parent_path() / (json.stem().string() + "_cache");
 }
 
+// Join a list of Uuids for error messages
+inline auto CycleMessage(const std::vector<Uuid>& cycle) -> std::string
+{
+    std::string msg{"Graph contains a cycle:"};
+    for (const auto& u : cycle) {
+        msg += " " + u.string() + " ->";
+    }
+    if (not cycle.empty()) {
+        msg += " " + cycle.front().string();
+    }
+    return msg;
+}
+
+// Serialize a list of nodes, concurrently if a pool is provided
+inline auto SerializeNodes(
+    const std::vector<Node::Pointer>& nodes,
+    bool useCache,
+    const fs::path& cacheDir,
+    ThreadPool* pool) -> std::vector<Metadata>
+{
+    std::vector<Metadata> result(nodes.size());
+    auto serialize = [&](std::size_t i) {
+        LogDebug("[Graph::Serialize]", "Node UUID:", nodes[i]->uuid().string());
+        result[i] = nodes[i]->serialize(useCache, cacheDir);
+    };
+    if (pool == nullptr) {
+        for (std::size_t i = 0; i < nodes.size(); i++) {
+            serialize(i);
+        }
+        return result;
+    }
+
+    // Tasks own the completion state and a copy of serialize, since the last
+    // task may still be returning when the caller wakes up
+    struct Completion {
+        std::mutex mutex;
+        std::condition_variable done;
+        std::size_t remaining;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<Completion>();
+    state->remaining = nodes.size();
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+        pool->submit([state, serialize, i]() {
+            std::exception_ptr e;
+            try {
+                serialize(i);
+            } catch (...) {
+                e = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (e and not state->error) {
+                state->error = e;
+            }
+            if (--state->remaining == 0) {
+                state->done.notify_all();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state]() { return state->remaining == 0; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+    return result;
+}
+
+// Validate the header members of a Graph file
+inline void ValidateHeader(const Metadata& header)
+{
+    if (not(header.contains("software") and header["software"] == "smgl")) {
+        throw std::runtime_error("File not generated by smgl");
+    }
+    if (not(header.contains("type") and header["type"] == "graph")) {
+        throw std::runtime_error("File not a smgl Graph");
+    }
+}
+
+namespace
+{
+// Streams a Graph file into a Graph. Nodes are constructed as soon as they
+// are read if the header members which precede them are valid. Otherwise,
+// they are held until the whole file has been read. If a pool is provided,
+// Nodes are constructed and deserialized on it while parsing continues.
+class GraphLoader : public detail::MetadataVisitor
+{
+public:
+    GraphLoader(Graph& g, fs::path path, ThreadPool* pool)
+        : g_{g}
+        , path_{std::move(path)}
+        // Braces would wrap the recovered object in an array
+        , recovered_(detail::MetadataJournal::Replay(path_))
+        , pool_{pool}
+        , limit_{(pool == nullptr) ? 0 : 2 * pool->size()}
+    {
+    }
+
+    // Tasks reference the loader
+    ~GraphLoader() override { wait_(); }
+
+    auto stream(const std::string& key) -> bool override
+    {
+        return key == "nodes" or key == "connections";
+    }
+
+    void member(const std::string& key, Metadata&& value) override
+    {
+        header_[key] = std::move(value);
+    }
+
+    void element(
+        const std::string& key,
+        const std::string& name,
+        Metadata&& value) override
+    {
+        if (key == "connections") {
+            connections_.emplace_back(std::move(value));
+            return;
+        }
+
+        // Recover Nodes recorded by an interrupted update
+        auto it = recovered_.find(name);
+        if (it != recovered_.end()) {
+            value = std::move(*it);
+        }
+        if (prepare_()) {
+            loadNode_(std::move(value));
+        } else {
+            pending_.emplace_back(std::move(value));
+        }
+    }
+
+    // Load the held Nodes and make the connections
+    void finish()
+    {
+        ValidateHeader(header_);
+        prepare_();
+        for (auto& n : pending_) {
+            loadNode_(std::move(n));
+        }
+        pending_.clear();
+
+        // Add the Nodes constructed by the pool in file order
+        wait_();
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        for (const auto& n : nodes_) {
+            g_.insertNode(n);
+        }
+
+        LogDebug("[Graph::Load]", "Loading connections");
+        for (const auto& c : connections_) {
+            // Get the nodes
+            auto srcNID = Uuid::FromString(c["srcNode"].get<std::string>());
+            auto srcNode = g_[srcNID];
+            auto dstNID = Uuid::FromString(c["destNode"].get<std::string>());
+            auto dstNode = g_[dstNID];
+
+            // Connect the ports
+            auto srcPID = Uuid::FromString(c["srcPort"].get<std::string>());
+            auto dstPID = Uuid::FromString(c["destPort"].get<std::string>());
+            connect(
+                srcNode->getOutputPort(srcPID),
+                dstNode->getInputPort(dstPID));
+        }
+    }
+
+    auto header() const -> const Metadata& { return header_; }
+
+    auto cacheType() const -> CacheType { return cacheType_; }
+
+private:
+    // Validate the header and load the cache directory once the header has
+    // been read
+    auto prepare_() -> bool
+    {
+        if (ready_) {
+            return true;
+        }
+        if (not(header_.contains("software") and header_.contains("type"))) {
+            return false;
+        }
+        ValidateHeader(header_);
+
+        if (header_.contains("cacheDir")) {
+            cacheDir_ = header_["cacheDir"].get<std::string>();
+            if (cacheDir_ == ".") {
+                cacheType_ = CacheType::Adjacent;
+                cacheDir_ = path_.parent_path();
+            } else {
+                cacheType_ = CacheType::Subdirectory;
+            }
+        } else {
+            cacheDir_ = path_.parent_path();
+        }
+        ready_ = true;
+        return true;
+    }
+
+    void loadNode_(Metadata nodeMeta)
+    {
+        if (pool_ == nullptr) {
+            g_.insertNode(createNode_(nodeMeta));
+            return;
+        }
+
+        // Limit the number of parsed Nodes waiting for a worker
+        std::unique_lock<std::mutex> lock(mutex_);
+        progress_.wait(lock, [this]() { return inflight_ < limit_; });
+        inflight_++;
+        auto idx = nodes_.size();
+        nodes_.emplace_back();
+        lock.unlock();
+
+        auto meta = std::make_shared<Metadata>(std::move(nodeMeta));
+        pool_->submit([this, idx, meta]() {
+            Node::Pointer n;
+            std::exception_ptr error;
+            try {
+                n = createNode_(*meta);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> guard(mutex_);
+            nodes_[idx] = std::move(n);
+            if (error and not error_) {
+                error_ = error;
+            }
+            inflight_--;
+            progress_.notify_all();
+        });
+    }
+
+    auto createNode_(const Metadata& nodeMeta) const -> Node::Pointer
+    {
+        // Construct the node
+        auto type = nodeMeta["type"].get<std::string>();
+        auto n = CreateNode(type);
+
+        // Load the node state
+        n->deserialize(nodeMeta, cacheDir_);
+        return n;
+    }
+
+    // Wait for the pool to finish the queued Nodes
+    void wait_()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        progress_.wait(lock, [this]() { return inflight_ == 0; });
+    }
+
+    Graph& g_;
+    fs::path path_;
+    Metadata recovered_;
+    Metadata header_;
+    bool ready_{false};
+    fs::path cacheDir_;
+    CacheType cacheType_{CacheType::Subdirectory};
+    std::vector<Metadata> pending_;
+    std::vector<Metadata> connections_;
+    ThreadPool* pool_;
+    std::size_t limit_;
+    std::size_t inflight_{0};
+    std::vector<Node::Pointer> nodes_;
+    std::exception_ptr error_;
+    std::mutex mutex_;
+    std::condition_variable progress_;
+};
+
+// Reads only the type of each Node in a Graph file
+class TypeScanner : public detail::MetadataVisitor
+{
+public:
+    auto stream(const std::string& key) -> bool override
+    {
+        return key == "nodes" or key == "connections";
+    }
+
+    auto keep(const std::string& key, const std::string& field)
+        -> bool override
+    {
+        return key == "nodes" and field == "type";
+    }
+
+    void member(const std::string& key, Metadata&& value) override
+    {
+        header_[key] = std::move(value);
+    }
+
+    void element(
+        const std::string& key,
+        const std::string& /*unused*/,
+        Metadata&& value) override
+    {
+        if (key == "nodes") {
+            types_.emplace_back(value["type"].get<std::string>());
+        }
+    }
+
+    auto header() const -> const Metadata& { return header_; }
+
+    auto types() const -> const std::vector<std::string>& { return types_; }
+
+private:
+    Metadata header_;
+    std::vector<std::string> types_;
+};
+}  // namespace
+
+cycle_error::cycle_error(std::vector<Uuid> cycle)
+    : std::runtime_error(CycleMessage(cycle)), cycle_{std::move(cycle)}
+{
+}
+
+auto cycle_error::cycle() const -> const std::vector<Uuid>& { return cycle_; }
+
+// Update a scheduled node. Returns true if the node was updated.
+inline auto ScheduledNodeReady(const Node::Pointer& n) -> bool
+{
+    // Only build the node description if it will be logged
+    if (detail::LogConf::Instance().check(LogLevel::Debug)) {
+        LogDebug(
+            "[Graph::update]", "Popped",
+            smgl::detail::type_name(*n) + "[" + n->uuid().short_string() +
+                "]");
+    }
+    auto state = n->state();
+    if (state == Node::State::Ready and n->blocked()) {
+        // Posting to a full queue could block the updating thread forever
+        LogDebug("[Graph::update]", "Outputs blocked. Deferring node");
+        return false;
+    } else if (state == Node::State::Ready) {
+        return true;
+    } else if (
+        state == Node::State::Waiting or state == Node::State::Updating) {
+        throw std::runtime_error("Node not ready but scheduled for update");
+    } else if (state == Node::State::Error) {
+        throw std::runtime_error("Node update error");
+    }
+    return false;
+}
+
+inline auto UpdateScheduledNode(const Node::Pointer& n) -> bool
+{
+    if (not ScheduledNodeReady(n)) {
+        return false;
+    }
+    LogDebug("[Graph::update]", "Updating node");
+    n->update();
+    return true;
+}
+
+auto ExecutionPlan::size() const -> std::size_t { return order_.size(); }
+
+auto ExecutionPlan::nodes() const -> const std::vector<Node::Pointer>&
+{
+    return order_;
+}
+
+auto ExecutionPlan::level(std::size_t i) const -> std::size_t
+{
+    return levels_[i];
+}
+
+auto ExecutionPlan::successors(std::size_t i) const -> IndexRange
+{
+    return {
+        successors_.data() + offsets_[i], successors_.data() + offsets_[i + 1]};
+}
+
+auto ExecutionPlan::predecessors(std::size_t i) const -> IndexRange
+{
+    return {
+        predecessors_.data() + predOffsets_[i],
+        predecessors_.data() + predOffsets_[i + 1]};
+}
+
 auto Graph::operator[](const Uuid& uuid) const -> Node::Pointer
 {
     auto it = nodes_.find(uuid);
@@ -34,11 +421,16 @@ auto Graph::operator[](const Uuid& uuid) const -> Node::Pointer
     }
 }
 
-void Graph::insertNode(const Node::Pointer& n) { nodes_[n->uuid()] = n; }
+void Graph::insertNode(const Node::Pointer& n)
+{
+    nodes_[n->uuid()] = n;
+    version_++;
+}
 
 void Graph::removeNode(const Node::Pointer& n)
 {
     nodes_.erase(n->uuid());
+    version_++;
     // TODO: Remove all Node connections
 }
 
@@ -61,6 +453,10 @@ auto Graph::cacheType() const -> CacheType { return cacheType_; }
 
 void Graph::setCacheType(CacheType t) { cacheType_ = t; }
 
+auto Graph::cacheFormat() const -> MetadataFormat { return cacheFormat_; }
+
+void Graph::setCacheFormat(MetadataFormat format) { cacheFormat_ = format; }
+
 auto Graph::cacheDir() const -> fs::path
 {
     return CacheDir(cacheFile(), cacheType_);
@@ -70,6 +466,17 @@ auto Graph::cacheEnabled() const -> bool { return cache_enabled_; }
 
 void Graph::setEnableCache(bool enable) { cache_enabled_ = enable; }
 
+auto Graph::asyncCache() const -> bool { return asyncCache_; }
+
+void Graph::setAsyncCache(bool async) { asyncCache_ = async; }
+
+void Graph::flushCache()
+{
+    if (cacheWriter_) {
+        cacheWriter_->flush();
+    }
+}
+
 void Graph::setProjectMetadata(const Metadata& m) { extraMetadata_ = m; }
 
 auto Graph::projectMetadata() const -> const Metadata&
@@ -79,7 +486,39 @@ auto Graph::projectMetadata() const -> const Metadata&
 
 auto Graph::projectMetadata() -> Metadata& { return extraMetadata_; }
 
+auto Graph::numThreads() const -> std::size_t { return numThreads_; }
+
+void Graph::setNumThreads(std::size_t n) { numThreads_ = n; }
+
 auto Graph::update() -> Graph::State
+{
+    return update_all_(std::make_shared<detail::UpdateStatus>());
+}
+
+auto Graph::updateAsync() -> UpdateHandle
+{
+    auto status = std::make_shared<detail::UpdateStatus>();
+    auto result = std::async(std::launch::async, [this, status]() {
+        return update_all_(status);
+    });
+    return {result.share(), status};
+}
+
+auto Graph::update_all_(std::shared_ptr<detail::UpdateStatus> status)
+    -> Graph::State
+{
+    // If already operating or in error, return
+    if (state_ == State::Updating or state_ == State::Error) {
+        LogDebug("[Graph::update]", "Graph updating or in error");
+        return state_;
+    }
+
+    // Schedule nodes
+    compile();
+    return update_({}, std::move(status));
+}
+
+auto Graph::update(const std::vector<Node::Pointer>& targets) -> Graph::State
 {
     // If already operating or in error, return
     if (state_ == State::Updating or state_ == State::Error) {
@@ -88,52 +527,543 @@ auto Graph::update() -> Graph::State
     }
 
     // Schedule nodes
-    LogDebug("[Graph::update]", "Building schedule");
-    auto schedule = Schedule(*this);
+    compile();
+
+    // Mark the targets
+    std::unordered_set<const Node*> targetSet;
+    for (const auto& t : targets) {
+        if (t == nullptr) {
+            throw std::invalid_argument("Target node is a nullptr");
+        }
+        auto it = nodes_.find(t->uuid());
+        if (it == nodes_.end() or it->second != t) {
+            throw std::invalid_argument(
+                "Node not in graph: " + t->uuid().string());
+        }
+        targetSet.insert(t.get());
+    }
+    if (targetSet.empty()) {
+        return state_;
+    }
+
+    // Walk the schedule backwards: a Node is needed if it is a target or if
+    // any of its downstream Nodes are needed
+    LogDebug("[Graph::update]", "Selecting upstream nodes");
+    const auto& plan = *plan_;
+    const auto& order = plan.order_;
+    std::vector<bool> active(order.size(), false);
+    for (auto i = order.size(); i-- > 0;) {
+        if (targetSet.count(order[i].get()) > 0) {
+            active[i] = true;
+            continue;
+        }
+        for (auto e = plan.offsets_[i]; e < plan.offsets_[i + 1]; e++) {
+            if (active[plan.successors_[e]]) {
+                active[i] = true;
+                break;
+            }
+        }
+    }
 
-    // Set up the cache info
-    auto cacheJson = cacheFile();
-    auto cacheDir = CacheDir(cacheJson, cacheType_);
+    return update_(active, std::make_shared<detail::UpdateStatus>());
+}
+
+auto Graph::stream(const Feed& feed) -> Graph::State
+{
+    // If already operating or in error, return
+    if (state_ == State::Updating or state_ == State::Error) {
+        LogDebug("[Graph::stream]", "Graph updating or in error");
+        return state_;
+    }
+
+    // Schedule nodes
+    compile();
 
     // Write the graph starting state
-    Metadata meta;
-    if (cache_enabled_) {
-        LogDebug("[Graph::update]", "Initializing cache");
-        meta = Serialize(*this, cache_enabled_, cacheDir);
-        WriteMetadata(cacheJson, meta);
+    auto cacheDir = CacheDir(cacheFile(), cacheType_);
+    auto journal = open_cache_(cacheDir);
+
+    // Execute the stream
+    set_status_(std::make_shared<detail::UpdateStatus>());
+    state_ = State::Updating;
+    LogDebug("[Graph::stream]", "Executing stream");
+    try {
+        update_stream_(feed, journal, cacheDir);
+    } catch (...) {
+        abort_cache_(journal);
+        throw;
     }
+    close_cache_(journal);
+    state_ = State::Idle;
+    return state_;
+}
+
+auto Graph::update_(
+    const std::vector<bool>& active,
+    std::shared_ptr<detail::UpdateStatus> status) -> Graph::State
+{
+    // Set up progress reporting
+    if (active.empty()) {
+        status->total = plan_->size();
+    } else {
+        status->total = static_cast<std::size_t>(
+            std::count(active.begin(), active.end(), true));
+    }
+    set_status_(std::move(status));
+
+    // Write the graph starting state
+    auto cacheDir = CacheDir(cacheFile(), cacheType_);
+    auto journal = open_cache_(cacheDir);
 
     // Execute our schedule
     state_ = State::Updating;
     LogDebug("[Graph::update]", "Executing schedule");
-    for (auto& n : schedule) {
-        LogDebug(
-            "[Graph::update]", "Popped",
-            smgl::detail::type_name(*n) + "[" + n->uuid().short_string() + "]");
-        auto state = n->state();
-        if (state == Node::State::Ready) {
-            LogDebug("[Graph::update]", "Updating node");
-            n->update();
-
-            // Write to cache
-            if (cache_enabled_) {
-                LogDebug("[Graph::update]", "Serializing node");
-                // Write to the cache
-                auto uuid = n->uuid().string();
-                meta["nodes"][uuid] = n->serialize(cache_enabled_, cacheDir);
-                WriteMetadata(cacheJson, meta);
-            }
-        } else if (
-            state == Node::State::Waiting or state == Node::State::Updating) {
-            throw std::runtime_error("Node not ready but scheduled for update");
-        } else if (state == Node::State::Error) {
-            throw std::runtime_error("Node update error");
+    try {
+        if (numThreads_ == 1) {
+            update_serial_(active, journal, cacheDir);
+        } else {
+            update_parallel_(active, journal, cacheDir);
         }
+    } catch (...) {
+        abort_cache_(journal);
+        throw;
     }
+    close_cache_(journal);
     state_ = State::Idle;
     return state_;
 }
 
+void Graph::set_status_(std::shared_ptr<detail::UpdateStatus> status)
+{
+    status_ = std::move(status);
+    std::shared_ptr<const std::atomic<bool>> cancelled{
+        status_, &status_->cancelled};
+    for (const auto& n : plan_->order_) {
+        n->cancelled_ = cancelled;
+    }
+}
+
+auto Graph::compile() -> std::shared_ptr<const ExecutionPlan>
+{
+    // Check whether the topology has changed since the last compile
+    auto epoch = detail::ConnectionEpoch();
+    if (plan_ and planVersion_ == version_ and planEpoch_ == epoch) {
+        LogDebug("[Graph::compile]", "Reusing compiled plan");
+        return plan_;
+    }
+
+    LogDebug("[Graph::compile]", "Building plan");
+    plan_ = std::make_shared<const ExecutionPlan>(Sort(*this));
+    planVersion_ = version_;
+    planEpoch_ = epoch;
+    return plan_;
+}
+
+void Graph::update_serial_(
+    const std::vector<bool>& active,
+    const std::shared_ptr<detail::MetadataJournal>& journal,
+    const fs::path& cacheDir)
+{
+    const auto& schedule = plan_->order_;
+    for (std::size_t i = 0; i < schedule.size(); i++) {
+        if (not active.empty() and not active[i]) {
+            continue;
+        }
+        if (status_->cancelled) {
+            LogDebug("[Graph::update]", "Update cancelled");
+            break;
+        }
+        const auto& n = schedule[i];
+        if (UpdateScheduledNode(n) and journal) {
+            cache_node_(journal, n, cacheDir);
+        }
+        status_->completed++;
+    }
+}
+
+void Graph::update_parallel_(
+    const std::vector<bool>& active,
+    const std::shared_ptr<detail::MetadataJournal>& journal,
+    const fs::path& cacheDir)
+{
+    start_pool_();
+
+    // Initialize the dependency counters
+    const auto& plan = *plan_;
+    const auto& schedule = plan.order_;
+    const auto& offsets = plan.offsets_;
+    const auto& successors = plan.successors_;
+    auto numNodes = schedule.size();
+    auto isActive = [&active](std::size_t i) {
+        return active.empty() or active[i];
+    };
+    std::unique_ptr<std::atomic<std::size_t>[]> pending{
+        new std::atomic<std::size_t>[numNodes]};
+    std::size_t numActive{0};
+    for (std::size_t i = 0; i < numNodes; i++) {
+        pending[i] = plan.predOffsets_[i + 1] - plan.predOffsets_[i];
+        numActive += isActive(i) ? 1 : 0;
+    }
+    if (numActive == 0) {
+        return;
+    }
+
+    // Shared execution state
+    std::mutex mutex;
+    std::condition_variable done;
+    std::size_t remaining{numActive};
+    std::exception_ptr error;
+    std::atomic<bool> failed{false};
+    std::mutex cacheMutex;
+
+    // Task for a Ready node. After the node finishes (or is skipped because
+    // of an earlier error), every successor whose dependencies have all
+    // completed is either pushed onto the pool's ready queue or, if it has no
+    // queued inputs, resolved inline without a task of its own. Tasks share
+    // ownership of it, since the last one may still be returning from it
+    // after this function has been woken up.
+    auto run = std::make_shared<std::function<void(std::size_t)>>();
+    *run = [&](std::size_t idx) {
+        std::vector<std::size_t> resolved{idx};
+        std::size_t finished{0};
+        while (not resolved.empty()) {
+            auto i = resolved.back();
+            resolved.pop_back();
+            const auto& n = schedule[i];
+            if (not failed and not status_->cancelled) {
+                try {
+                    if (UpdateScheduledNode(n) and journal) {
+                        std::lock_guard<std::mutex> lock(cacheMutex);
+                        cache_node_(journal, n, cacheDir);
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (not error) {
+                        error = std::current_exception();
+                    }
+                    failed = true;
+                }
+                status_->completed++;
+            }
+
+            for (auto e = offsets[i]; e < offsets[i + 1]; e++) {
+                auto s = successors[e];
+                if (not isActive(s) or --pending[s] != 0) {
+                    continue;
+                }
+                if (not failed and not status_->cancelled and
+                    schedule[s]->state() == Node::State::Ready) {
+                    pool_->submit([run, s]() { (*run)(s); });
+                } else {
+                    resolved.push_back(s);
+                }
+            }
+            finished++;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        remaining -= finished;
+        if (remaining == 0) {
+            done.notify_all();
+        }
+    };
+
+    // Launch the nodes without dependencies. Collect them first: once
+    // launched, workers will begin zeroing the counters of other nodes.
+    std::vector<std::size_t> roots;
+    for (std::size_t i = 0; i < numNodes; i++) {
+        if (isActive(i) and pending[i] == 0) {
+            roots.push_back(i);
+        }
+    }
+    for (const auto& i : roots) {
+        pool_->submit([run, i]() { (*run)(i); });
+    }
+
+    // Wait for all nodes to finish
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&remaining]() { return remaining == 0; });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void Graph::update_stream_(
+    const Feed& feed,
+    const std::shared_ptr<detail::MetadataJournal>& journal,
+    const fs::path& cacheDir)
+{
+    start_pool_();
+
+    const auto& plan = *plan_;
+    const auto& schedule = plan.order_;
+    const auto& offsets = plan.offsets_;
+    const auto& successors = plan.successors_;
+    const auto& predOffsets = plan.predOffsets_;
+    const auto& preds = plan.predecessors_;
+    auto numNodes = schedule.size();
+
+    // Source nodes are fed by a pseudo-node which runs the feed callback.
+    // done[i] is the number of frames finished by node i.
+    auto feedIdx = numNodes;
+    std::vector<std::size_t> roots;
+    for (std::size_t i = 0; i < numNodes; i++) {
+        if (predOffsets[i] == predOffsets[i + 1]) {
+            roots.push_back(i);
+        }
+    }
+    std::vector<std::size_t> done(numNodes + 1, 0);
+    std::vector<std::size_t> taken(numNodes, 0);
+    std::vector<bool> running(numNodes + 1, false);
+    auto numFrames = std::numeric_limits<std::size_t>::max();
+
+    // Shared execution state
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::size_t active{0};
+    std::exception_ptr error;
+    std::mutex cacheMutex;
+
+    // Whether node i can start its next frame. Must hold the lock.
+    auto canRun = [&](std::size_t i) {
+        auto f = done[i];
+        if (running[i] or error or status_->cancelled or f >= numFrames) {
+            return false;
+        }
+        if (i == feedIdx) {
+            return std::all_of(roots.begin(), roots.end(), [&](auto r) {
+                return taken[r] >= f;
+            });
+        }
+        // All upstream nodes have produced frame f
+        if (predOffsets[i] == predOffsets[i + 1]) {
+            if (done[feedIdx] <= f) {
+                return false;
+            }
+        }
+        for (auto e = predOffsets[i]; e < predOffsets[i + 1]; e++) {
+            if (done[preds[e]] <= f) {
+                return false;
+            }
+        }
+        // All downstream nodes have taken frame f - 1 from their inputs. They
+        // may still be computing it.
+        for (auto e = offsets[i]; e < offsets[i + 1]; e++) {
+            if (taken[successors[e]] < f) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Launch every node in the list which can start. Must hold the lock.
+    // Tasks share ownership of run, which may still be returning when the
+    // stream has drained.
+    using Task = std::function<void(std::size_t, std::size_t)>;
+    auto run = std::make_shared<Task>();
+    auto launch = [&](const std::vector<std::size_t>& candidates) {
+        for (const auto& i : candidates) {
+            if (canRun(i)) {
+                running[i] = true;
+                active++;
+                auto f = done[i];
+                pool_->submit([run, i, f]() { (*run)(i, f); });
+            }
+        }
+    };
+
+    // Nodes which can start once node i has taken its inputs. Must hold the
+    // lock.
+    auto upstream = [&](std::size_t i) {
+        std::vector<std::size_t> candidates(
+            preds.begin() + predOffsets[i], preds.begin() + predOffsets[i + 1]);
+        if (predOffsets[i] == predOffsets[i + 1]) {
+            candidates.push_back(feedIdx);
+        }
+        return candidates;
+    };
+
+    // Task for node i on frame f
+    *run = [&](std::size_t i, std::size_t f) {
+        auto more = true;
+        auto took = false;
+        // The upstream nodes can produce frame f + 1 while this one computes
+        auto take = [&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            taken[i]++;
+            took = true;
+            launch(upstream(i));
+        };
+        try {
+            if (i == feedIdx) {
+                LogDebug("[Graph::stream]", "Feeding frame", f);
+                more = feed(f);
+            } else {
+                const auto& n = schedule[i];
+                n->tick_ = f;
+                if (ScheduledNodeReady(n)) {
+                    LogDebug("[Graph::stream]", "Updating node");
+                    auto updated = n->update_input_ports_();
+                    take();
+                    if (updated) {
+                        n->compute_and_send_();
+                    }
+                    if (journal) {
+                        std::lock_guard<std::mutex> lock(cacheMutex);
+                        cache_node_(journal, n, cacheDir);
+                    }
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (not error) {
+                error = std::current_exception();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        running[i] = false;
+        active--;
+        if (i == feedIdx and not more) {
+            numFrames = f;
+        } else {
+            done[i]++;
+        }
+        if (i != feedIdx and not took) {
+            taken[i]++;
+        }
+
+        // Only this node and its neighbors can have become runnable
+        std::vector<std::size_t> candidates{i};
+        if (i == feedIdx) {
+            candidates.insert(candidates.end(), roots.begin(), roots.end());
+        } else {
+            auto up = upstream(i);
+            candidates.insert(candidates.end(), up.begin(), up.end());
+            candidates.insert(
+                candidates.end(), successors.begin() + offsets[i],
+                successors.begin() + offsets[i + 1]);
+        }
+        launch(candidates);
+
+        if (active == 0) {
+            finished.notify_all();
+        }
+    };
+
+    // Start with the feed and wait for the stream to drain
+    std::unique_lock<std::mutex> lock(mutex);
+    launch({feedIdx});
+    finished.wait(lock, [&active]() { return active == 0; });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+UpdateHandle::UpdateHandle(
+    std::shared_future<Graph::State> result,
+    std::shared_ptr<detail::UpdateStatus> status)
+    : result_{std::move(result)}, status_{std::move(status)}
+{
+}
+
+auto UpdateHandle::valid() const -> bool { return result_.valid(); }
+
+void UpdateHandle::cancel()
+{
+    if (status_) {
+        status_->cancelled = true;
+    }
+}
+
+auto UpdateHandle::cancelled() const -> bool
+{
+    return status_ and status_->cancelled;
+}
+
+auto UpdateHandle::completed() const -> std::size_t
+{
+    return status_ ? status_->completed.load() : 0;
+}
+
+auto UpdateHandle::total() const -> std::size_t
+{
+    return status_ ? status_->total.load() : 0;
+}
+
+void UpdateHandle::wait() const { result_.wait(); }
+
+auto UpdateHandle::get() const -> Graph::State { return result_.get(); }
+
+void Graph::start_pool_()
+{
+    auto threads = (numThreads_ == 0) ? ThreadPool::DefaultThreadCount()
+                                      : numThreads_;
+    if (not pool_ or pool_->size() != threads) {
+        LogDebug("[Graph::update]", "Starting thread pool:", threads);
+        pool_ = std::make_shared<ThreadPool>(threads);
+    }
+}
+
+auto Graph::open_cache_(const fs::path& cacheDir)
+    -> std::shared_ptr<detail::MetadataJournal>
+{
+    if (not cache_enabled_) {
+        return nullptr;
+    }
+
+    LogDebug("[Graph::update]", "Initializing cache");
+    if (numThreads_ != 1) {
+        start_pool_();
+    }
+    if (not cacheWriter_) {
+        cacheWriter_ = std::make_shared<CacheWriter>();
+    }
+    auto journal = std::make_shared<detail::MetadataJournal>();
+    auto meta = Serialize(*this, cache_enabled_, cacheDir);
+    cacheWriter_->submit(
+        [journal, json = cacheFile(), meta, format = cacheFormat_]() {
+            journal->open(json, meta, format);
+        });
+    return journal;
+}
+
+void Graph::cache_node_(
+    const std::shared_ptr<detail::MetadataJournal>& journal,
+    const Node::Pointer& n,
+    const fs::path& cacheDir)
+{
+    LogDebug("[Graph::update]", "Serializing node");
+    auto node = n->serialize(cache_enabled_, cacheDir);
+    cacheWriter_->submit([journal, uuid = n->uuid().string(), node]() {
+        journal->append(uuid, node);
+    });
+}
+
+void Graph::close_cache_(
+    const std::shared_ptr<detail::MetadataJournal>& journal)
+{
+    if (not journal) {
+        return;
+    }
+    cacheWriter_->submit([journal]() { journal->compact(); });
+    if (not asyncCache_) {
+        cacheWriter_->flush();
+    }
+}
+
+void Graph::abort_cache_(
+    const std::shared_ptr<detail::MetadataJournal>& journal) noexcept
+{
+    try {
+        close_cache_(journal);
+    } catch (const std::exception& e) {
+        LogError("[Graph::update]", "Failed to close cache:", e.what());
+    } catch (...) {
+        LogError("[Graph::update]", "Failed to close cache");
+    }
+}
+
 auto Graph::Serialize(const Graph& g) -> Metadata
 {
     return Serialize(g, g.cache_enabled_, CacheDir(g.cacheFile_, g.cacheType_));
@@ -167,16 +1097,38 @@ auto Graph::Serialize(const Graph& g, bool useCache, const fs::path& cacheDir)
     }
 
     LogDebug("[Graph::Serialize]", "Serializing nodes");
+    std::vector<Node::Pointer> nodes;
+    nodes.reserve(g.nodes_.size());
+    for (const auto& n : g.nodes_) {
+        nodes.push_back(n.second);
+    }
+
+    // Nodes write to disjoint cache subdirectories, so they can be
+    // serialized concurrently once the shared root exists
+    if (useCache and not cacheDir.empty()) {
+        fs::create_directories(cacheDir);
+    }
+    auto threads = (g.numThreads_ == 0) ? ThreadPool::DefaultThreadCount()
+                                        : g.numThreads_;
+    std::shared_ptr<ThreadPool> pool;
+    if (threads > 1 and nodes.size() > 1) {
+        pool = g.pool_;
+        if (not pool or pool->size() != threads) {
+            pool = std::make_shared<ThreadPool>(threads);
+        }
+    }
+    auto nodesMeta = SerializeNodes(nodes, useCache, cacheDir, pool.get());
+
+    // Merge in iteration order
     Metadata connections = Metadata::array();
     meta["nodes"] = Metadata::object();
-    for (const auto& n : g.nodes_) {
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+        const auto& n = nodes[i];
         // Write node metadata
-        auto uuid = n.first.string();
-        LogDebug("[Graph::Serialize]", "Node UUID:", uuid);
-        meta["nodes"][uuid] = n.second->serialize(useCache, cacheDir);
+        meta["nodes"][n->uuid().string()] = std::move(nodesMeta[i]);
 
         // Accumulate connections metadata
-        for (const auto& c : n.second->getOutputConnections()) {
+        for (const auto& c : n->getOutputConnections()) {
             // If any of these are nullptr, we have problems
             assert(c.srcNode != nullptr);
             assert(c.srcPort != nullptr);
@@ -196,106 +1148,70 @@ auto Graph::Serialize(const Graph& g, bool useCache, const fs::path& cacheDir)
     return meta;
 }
 
-void Graph::Save(const fs::path& path, const Graph& g, bool writeCache)
+void Graph::Save(
+    const fs::path& path,
+    const Graph& g,
+    bool writeCache,
+    MetadataFormat format)
 {
+    // Finish writing the cache before it is replaced
+    if (g.cacheWriter_) {
+        g.cacheWriter_->flush();
+    }
+
     // Construct the metadata
     auto meta = Serialize(g, writeCache, CacheDir(path, g.cacheType_));
 
     LogDebug("[Graph::Save]", "Writing metadata");
-    WriteMetadata(path, meta);
+    WriteMetadata(path, meta, format);
+
+    // The saved state supersedes an unfinished update journal
+    fs::remove(detail::MetadataJournal::Path(path));
 }
 
-auto Graph::Load(const fs::path& path) -> Graph
+auto Graph::Load(const fs::path& path, std::size_t numThreads) -> Graph
 {
-    // Load the metadata
-    LogDebug("[Graph::Load]", "Loading graph metadata");
-    auto meta = LoadMetadata(path);
-
-    // Validate the json file
-    if (not(meta.contains("software") and meta["software"] == "smgl")) {
-        throw std::runtime_error("File not generated by smgl");
-    }
-    if (not(meta.contains("type") and meta["type"] == "graph")) {
-        throw std::runtime_error("File not a smgl Graph");
-    }
-
     // Set up a new graph
     LogDebug("[Graph::Load]", "Initializing Graph");
     Graph g;
     g.cacheFile_ = path;
-
-    // Load the cache directory
-    fs::path cacheDir;
-    if (meta.contains("cacheDir")) {
-        cacheDir = meta["cacheDir"].get<std::string>();
-        if (cacheDir == ".") {
-            g.cacheType_ = CacheType::Adjacent;
-            cacheDir = path.parent_path();
-        } else {
-            g.cacheType_ = CacheType::Subdirectory;
-        }
-    } else {
-        cacheDir = path.parent_path();
+    g.numThreads_ = numThreads;
+    ThreadPool* pool{nullptr};
+    if (numThreads != 1) {
+        g.start_pool_();
+        pool = g.pool_.get();
     }
 
-    // Load the graph UUID
-    g.uuid_ = Uuid::FromString(meta["uuid"].get<std::string>());
-    LogDebug("[Graph::Load]", "Graph UUID:", g.uuid_.string());
-
-    // Load the nodes
-    LogDebug("[Graph::Load]", "Loading nodes");
-    for (const auto& node : meta["nodes"].items()) {
-        auto nodeMeta = node.value();
-        // Construct the node
-        auto type = nodeMeta["type"].get<std::string>();
-        auto n = CreateNode(type);
-
-        // Load the node state
-        n->deserialize(nodeMeta, cacheDir);
-
-        // Add to the graph
-        g.insertNode(n);
-    }
-
-    // Make connections
-    LogDebug("[Graph::Load]", "Loading connections");
-    for (const auto& c : meta["connections"]) {
-        // Get the nodes
-        auto srcNID = Uuid::FromString(c["srcNode"].get<std::string>());
-        auto srcNode = g[srcNID];
-        auto dstNID = Uuid::FromString(c["destNode"].get<std::string>());
-        auto dstNode = g[dstNID];
-
-        // Connect the ports
-        auto srcPID = Uuid::FromString(c["srcPort"].get<std::string>());
-        auto dstPID = Uuid::FromString(c["destPort"].get<std::string>());
-        connect(srcNode->getOutputPort(srcPID), dstNode->getInputPort(dstPID));
+    // Stream the nodes and connections into the graph
+    LogDebug("[Graph::Load]", "Loading graph");
+    {
+        GraphLoader loader(g, path, pool);
+        detail::VisitMetadata(path, loader);
+        loader.finish();
+        g.cacheType_ = loader.cacheType();
+        g.uuid_ =
+            Uuid::FromString(loader.header().at("uuid").get<std::string>());
     }
+    LogDebug("[Graph::Load]", "Graph UUID:", g.uuid_.string());
 
     return g;
 }
 
 auto Graph::CheckRegistration(const fs::path& path) -> std::vector<std::string>
 {
-    // Load the metadata
+    // Scan the node types
     const std::string logPrefix{"[Graph::CheckRegistration(path)]"};
-    LogDebug(logPrefix, "Loading graph metadata");
-    auto meta = LoadMetadata(path);
+    LogDebug(logPrefix, "Scanning graph metadata");
+    TypeScanner scanner;
+    detail::VisitMetadata(path, scanner);
 
     // Validate the json file
-    if (not(meta.contains("software") and meta["software"] == "smgl")) {
-        throw std::runtime_error("File not generated by smgl");
-    }
-    if (not(meta.contains("type") and meta["type"] == "graph")) {
-        throw std::runtime_error("File not a smgl Graph");
-    }
+    ValidateHeader(scanner.header());
 
     // Check that all nodes are registered
     std::vector<std::string> ids;
     LogDebug(logPrefix, "Checking node types");
-    for (const auto& node : meta["nodes"].items()) {
-        auto nodeMeta = node.value();
-        auto type = nodeMeta["type"].get<std::string>();
+    for (const auto& type : scanner.types()) {
         if (not IsRegistered(type)) {
             LogDebug(logPrefix, "Type:", type, "Registered:", false);
             ids.emplace_back(type);
@@ -329,87 +1245,152 @@ auto Graph::CheckRegistration(const Graph& g) -> std::vector<std::string>
 
 auto Graph::Schedule(const Graph& g) -> std::vector<Node::Pointer>
 {
-    // Node helper struct
-    struct NodeHelper {
-        using Ptr = std::shared_ptr<NodeHelper>;
-        Uuid uuid;
-        Ptr parent;
-        size_t inCns{0};
-        std::vector<Uuid> cns;
-        size_t start{0};
-        size_t end{0};
-        bool visited{false};
-    };
+    return Sort(g).order_;
+}
 
-    // TODO: Detect whether DAG
-
-    // Setup node list
-    LogDebug("[Graph::Schedule] Building node list");
-    std::unordered_map<Uuid, NodeHelper::Ptr> ns;
-    for (const auto& node : g.nodes_) {
-        // Make the node helper
-        auto n = std::make_shared<NodeHelper>();
-        n->uuid = node.first;
-        n->inCns = node.second->getNumberOfInputConnections();
-        // Add connections
-        for (const auto& c : node.second->getOutputConnections()) {
-            n->cns.push_back(c.destNode->uuid());
-        }
-        // Assign to the node list
-        ns[node.first] = n;
-    }
-
-    // Set up DFS++
-    LogDebug("[Graph::Schedule]", "Set up DFS");
-    size_t time{0};
-    using VisitFnT = std::function<void(NodeHelper::Ptr&)>;
-    VisitFnT visit = [&time, &visit, &ns](NodeHelper::Ptr& u) {
-        if (u->visited) {
-            return;
+auto Graph::ScheduleLevels(const Graph& g)
+    -> std::vector<std::vector<Node::Pointer>>
+{
+    auto topo = Sort(g);
+    std::vector<std::vector<Node::Pointer>> levels;
+    for (std::size_t i = 0; i < topo.order_.size(); i++) {
+        auto l = topo.levels_[i];
+        if (l >= levels.size()) {
+            levels.resize(l + 1);
         }
+        levels[l].emplace_back(std::move(topo.order_[i]));
+    }
+    return levels;
+}
 
-        time++;
-        u->start = time;
-        u->visited = true;
-        for (auto& c : u->cns) {
-            auto v = ns[c];
-            if (not v->visited) {
-                v->parent = u;
-                visit(v);
+auto Graph::Sort(const Graph& g) -> ExecutionPlan
+{
+    // Index the nodes
+    LogDebug("[Graph::Schedule]", "Building node list");
+    auto numNodes = g.nodes_.size();
+    std::vector<Node::Pointer> nodes;
+    nodes.reserve(numNodes);
+    std::unordered_map<const Node*, std::size_t> indices;
+    indices.reserve(numNodes);
+    for (const auto& n : g.nodes_) {
+        indices[n.second.get()] = nodes.size();
+        nodes.emplace_back(n.second);
+    }
+
+    // Build the unique downstream edges of each node
+    LogDebug("[Graph::Schedule]", "Building edge list");
+    std::vector<std::size_t> offsets(numNodes + 1, 0);
+    std::vector<std::size_t> edges;
+    std::vector<std::size_t> inDegree(numNodes, 0);
+    std::vector<std::size_t> lastSeen(numNodes, numNodes);
+    for (std::size_t i = 0; i < numNodes; i++) {
+        for (const auto& c : nodes[i]->getOutputConnections()) {
+            auto it = indices.find(c.destNode);
+            if (it == indices.end() or lastSeen[it->second] == i) {
+                continue;
             }
+            lastSeen[it->second] = i;
+            edges.push_back(it->second);
+            inDegree[it->second]++;
         }
-        time++;
-        u->end = time;
-    };
+        offsets[i + 1] = edges.size();
+    }
 
-    // Run DFS++
-    LogDebug("[Graph::Schedule]", "Execute DFS");
-    for (auto& n : ns) {
-        if (n.second->inCns == 0) {
-            visit(n.second);
+    // Kahn's algorithm: order doubles as the FIFO queue
+    LogDebug("[Graph::Schedule]", "Sorting nodes");
+    std::vector<std::size_t> order;
+    order.reserve(numNodes);
+    std::vector<std::size_t> levels(numNodes, 0);
+    for (std::size_t i = 0; i < numNodes; i++) {
+        if (inDegree[i] == 0) {
+            order.push_back(i);
+        }
+    }
+    for (std::size_t head = 0; head < order.size(); head++) {
+        auto u = order[head];
+        for (auto e = offsets[u]; e < offsets[u + 1]; e++) {
+            auto v = edges[e];
+            levels[v] = std::max(levels[v], levels[u] + 1);
+            if (--inDegree[v] == 0) {
+                order.push_back(v);
+            }
         }
     }
 
-    // Sort the results by decreasing end time
-    LogDebug("[Graph::Schedule]", "Sorting results");
-    std::vector<NodeHelper::Ptr> dfs;
-    dfs.reserve(ns.size());
-    for (const auto& n : ns) {
-        if (not n.second->visited) {
-            throw std::runtime_error("Unscheduled node: " + n.first.string());
+    // Any node which was not sorted is in or downstream of a cycle
+    if (order.size() != numNodes) {
+        LogDebug("[Graph::Schedule]", "Graph contains a cycle");
+        // Every unsorted node has an unsorted upstream node, so walking
+        // upstream from any unsorted node must eventually revisit a node
+        std::vector<std::size_t> upstream(numNodes, numNodes);
+        for (std::size_t u = 0; u < numNodes; u++) {
+            if (inDegree[u] == 0) {
+                continue;
+            }
+            for (auto e = offsets[u]; e < offsets[u + 1]; e++) {
+                upstream[edges[e]] = u;
+            }
+        }
+        auto start = static_cast<std::size_t>(std::distance(
+            inDegree.begin(),
+            std::find_if(inDegree.begin(), inDegree.end(), [](auto d) {
+                return d > 0;
+            })));
+        std::vector<std::size_t> visited(numNodes, numNodes);
+        std::vector<std::size_t> path;
+        auto u = start;
+        while (visited[u] == numNodes) {
+            visited[u] = path.size();
+            path.push_back(u);
+            u = upstream[u];
         }
-        dfs.emplace_back(n.second);
+
+        // The walk is in upstream order, so reverse it
+        std::vector<Uuid> cycle;
+        for (auto it = path.rbegin(); it != path.rend(); it++) {
+            cycle.emplace_back(nodes[*it]->uuid());
+            if (*it == u) {
+                break;
+            }
+        }
+        throw cycle_error(cycle);
     }
-    std::sort(dfs.begin(), dfs.end(), [](const auto& lhs, const auto& rhs) {
-        return lhs->end > rhs->end;
-    });
 
-    // Convert to a schedule
+    // Convert to schedule order
     LogDebug("[Graph::Schedule]", "Building final schedule");
-    std::vector<Node::Pointer> schedule;
-    schedule.reserve(dfs.size());
-    for (const auto& n : dfs) {
-        schedule.emplace_back(g[n->uuid]);
+    std::vector<std::size_t> position(numNodes);
+    for (std::size_t k = 0; k < numNodes; k++) {
+        position[order[k]] = k;
+    }
+    ExecutionPlan topo;
+    topo.order_.reserve(numNodes);
+    topo.levels_.reserve(numNodes);
+    topo.offsets_.reserve(numNodes + 1);
+    topo.successors_.reserve(edges.size());
+    topo.offsets_.push_back(0);
+    for (const auto& i : order) {
+        topo.order_.emplace_back(std::move(nodes[i]));
+        topo.levels_.push_back(levels[i]);
+        for (auto e = offsets[i]; e < offsets[i + 1]; e++) {
+            topo.successors_.push_back(position[edges[e]]);
+        }
+        topo.offsets_.push_back(topo.successors_.size());
+    }
+
+    // Invert the successor lists
+    topo.predOffsets_.assign(numNodes + 1, 0);
+    topo.predecessors_.resize(edges.size());
+    for (const auto& v : topo.successors_) {
+        topo.predOffsets_[v + 1]++;
+    }
+    for (std::size_t k = 0; k < numNodes; k++) {
+        topo.predOffsets_[k + 1] += topo.predOffsets_[k];
+    }
+    auto fill = topo.predOffsets_;
+    for (std::size_t k = 0; k < numNodes; k++) {
+        for (auto e = topo.offsets_[k]; e < topo.offsets_[k + 1]; e++) {
+            topo.predecessors_[fill[topo.successors_[e]]++] = k;
+        }
     }
-    return schedule;
+    return topo;
 }
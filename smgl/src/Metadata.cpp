@@ -1,21 +1,489 @@
 #include "smgl/Metadata.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
 #include <fstream>
 #include <iomanip>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
 
 using namespace smgl;
 
-void smgl::WriteMetadata(const filesystem::path& path, const Metadata& m)
+namespace
 {
+// Select a format from the file extension
+auto FormatFromExtension(const filesystem::path& path) -> MetadataFormat
+{
+    auto ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    });
+    if (ext == ".cbor") {
+        return MetadataFormat::CBOR;
+    }
+    if (ext == ".msgpack" or ext == ".mpk") {
+        return MetadataFormat::MsgPack;
+    }
+    if (ext == ".ubj" or ext == ".ubjson") {
+        return MetadataFormat::UBJSON;
+    }
+    return MetadataFormat::JSON;
+}
+
+// Detect the format from the first bytes of a serialized object
+auto FormatFromContents(const std::uint8_t* bytes, std::size_t size)
+    -> MetadataFormat
+{
+    if (size == 0) {
+        return MetadataFormat::JSON;
+    }
+    auto first = bytes[0];
+    // CBOR maps: major type 5
+    if (first >= 0xA0 and first <= 0xBF) {
+        return MetadataFormat::CBOR;
+    }
+    // MessagePack maps: fixmap, map 16, map 32
+    if ((first >= 0x80 and first <= 0x8F) or first == 0xDE or first == 0xDF) {
+        return MetadataFormat::MsgPack;
+    }
+    // UBJSON and JSON objects both start with '{'. UBJSON follows it with a
+    // type marker, JSON with whitespace or a quote.
+    if (first == '{' and size > 1) {
+        auto next = bytes[1];
+        for (auto marker : {'i', 'U', 'I', 'l', 'L', '#', '$'}) {
+            if (next == static_cast<std::uint8_t>(marker)) {
+                return MetadataFormat::UBJSON;
+            }
+        }
+    }
+    return MetadataFormat::JSON;
+}
+// Detect the format of a stream without consuming it
+auto FormatFromStream(std::istream& is) -> MetadataFormat
+{
+    std::array<std::uint8_t, 2> bytes{};
+    is.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+    auto size = static_cast<std::size_t>(is.gcount());
+    is.clear();
+    is.seekg(0);
+    return FormatFromContents(bytes.data(), size);
+}
+
+auto InputFormat(MetadataFormat format) -> Metadata::input_format_t
+{
+    switch (format) {
+        case MetadataFormat::CBOR:
+            return Metadata::input_format_t::cbor;
+        case MetadataFormat::MsgPack:
+            return Metadata::input_format_t::msgpack;
+        case MetadataFormat::UBJSON:
+            return Metadata::input_format_t::ubjson;
+        default:
+            return Metadata::input_format_t::json;
+    }
+}
+
+// Builds a Metadata value from SAX events
+class MetadataBuilder
+{
+public:
+    // Add a value. Returns true if it completes the root value.
+    auto value(Metadata&& v) -> bool
+    {
+        if (stack_.empty()) {
+            root_ = std::move(v);
+            return true;
+        }
+        insert_(std::move(v));
+        return false;
+    }
+
+    // Open an object or array
+    void start(Metadata&& container)
+    {
+        if (stack_.empty()) {
+            root_ = std::move(container);
+            stack_.push_back(&root_);
+        } else {
+            stack_.push_back(insert_(std::move(container)));
+        }
+    }
+
+    // Close an object or array. Returns true if it completes the root value.
+    auto end() -> bool
+    {
+        stack_.pop_back();
+        return stack_.empty();
+    }
+
+    void key(std::string&& k) { key_ = std::move(k); }
+
+    // Number of open containers
+    auto depth() const -> std::size_t { return stack_.size(); }
+
+    auto take() -> Metadata { return std::move(root_); }
+
+private:
+    auto insert_(Metadata&& v) -> Metadata*
+    {
+        auto* top = stack_.back();
+        if (top->is_array()) {
+            top->push_back(std::move(v));
+            return &top->back();
+        }
+        auto& ref = (*top)[key_];
+        ref = std::move(v);
+        return &ref;
+    }
+
+    Metadata root_;
+    std::vector<Metadata*> stack_;
+    std::string key_;
+};
+
+// SAX handler which passes a Metadata object's contents to a visitor
+class VisitorSax
+{
+public:
+    using Int = Metadata::number_integer_t;
+    using UInt = Metadata::number_unsigned_t;
+    using Float = Metadata::number_float_t;
+    using String = Metadata::string_t;
+    using Binary = Metadata::binary_t;
+
+    explicit VisitorSax(detail::MetadataVisitor& visitor) : visitor_{visitor}
+    {
+    }
+
+    auto null() -> bool { return value_(nullptr); }
+    auto boolean(bool v) -> bool { return value_(v); }
+    auto number_integer(Int v) -> bool { return value_(v); }
+    auto number_unsigned(UInt v) -> bool { return value_(v); }
+    auto number_float(Float v, const String& /*unused*/) -> bool
+    {
+        return value_(v);
+    }
+    auto string(String& v) -> bool { return value_(std::move(v)); }
+    auto binary(Binary& v) -> bool { return value_(std::move(v)); }
+
+    auto start_object(std::size_t /*unused*/) -> bool
+    {
+        return start_(Metadata::object());
+    }
+    auto start_array(std::size_t /*unused*/) -> bool
+    {
+        return start_(Metadata::array());
+    }
+    auto end_object() -> bool { return end_(); }
+    auto end_array() -> bool { return end_(); }
+
+    auto key(String& k) -> bool
+    {
+        switch (mode_) {
+            case Mode::Root:
+                member_ = std::move(k);
+                break;
+            case Mode::Container:
+                name_ = std::move(k);
+                break;
+            case Mode::Element:
+                if (skip_ > 0) {
+                    break;
+                }
+                // Skip unwanted fields of an element object
+                if (builder_.depth() == 1 and not visitor_.keep(member_, k)) {
+                    skipping_ = true;
+                    break;
+                }
+                builder_.key(std::move(k));
+                break;
+            default:
+                builder_.key(std::move(k));
+                break;
+        }
+        return true;
+    }
+
+    auto parse_error(
+        std::size_t /*unused*/,
+        const std::string& /*unused*/,
+        const Metadata::exception& e) -> bool
+    {
+        throw std::runtime_error(e.what());
+    }
+
+private:
+    enum class Mode { Start, Root, Container, Member, Element, Done };
+
+    auto value_(Metadata&& v) -> bool
+    {
+        switch (mode_) {
+            case Mode::Start:
+                throw std::runtime_error("Metadata is not an object");
+            case Mode::Root:
+                visitor_.member(member_, std::move(v));
+                break;
+            case Mode::Container:
+                visitor_.element(member_, name_, std::move(v));
+                name_.clear();
+                break;
+            case Mode::Member:
+                builder_.value(std::move(v));
+                break;
+            case Mode::Element:
+                if (skip_ > 0) {
+                    break;
+                }
+                if (skipping_) {
+                    skipping_ = false;
+                    break;
+                }
+                builder_.value(std::move(v));
+                break;
+            case Mode::Done:
+                break;
+        }
+        return true;
+    }
+
+    auto start_(Metadata&& container) -> bool
+    {
+        switch (mode_) {
+            case Mode::Start:
+                if (not container.is_object()) {
+                    throw std::runtime_error("Metadata is not an object");
+                }
+                mode_ = Mode::Root;
+                break;
+            case Mode::Root:
+                if (visitor_.stream(member_)) {
+                    mode_ = Mode::Container;
+                } else {
+                    mode_ = Mode::Member;
+                    builder_.start(std::move(container));
+                }
+                break;
+            case Mode::Container:
+                mode_ = Mode::Element;
+                builder_.start(std::move(container));
+                break;
+            case Mode::Member:
+                builder_.start(std::move(container));
+                break;
+            case Mode::Element:
+                if (skip_ > 0 or skipping_) {
+                    skipping_ = false;
+                    skip_++;
+                    break;
+                }
+                builder_.start(std::move(container));
+                break;
+            case Mode::Done:
+                break;
+        }
+        return true;
+    }
+
+    auto end_() -> bool
+    {
+        switch (mode_) {
+            case Mode::Root:
+                mode_ = Mode::Done;
+                break;
+            case Mode::Container:
+                mode_ = Mode::Root;
+                break;
+            case Mode::Member:
+                if (builder_.end()) {
+                    mode_ = Mode::Root;
+                    visitor_.member(member_, builder_.take());
+                }
+                break;
+            case Mode::Element:
+                if (skip_ > 0) {
+                    skip_--;
+                    break;
+                }
+                if (builder_.end()) {
+                    mode_ = Mode::Container;
+                    visitor_.element(member_, name_, builder_.take());
+                    name_.clear();
+                }
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+
+    detail::MetadataVisitor& visitor_;
+    Mode mode_{Mode::Start};
+    MetadataBuilder builder_;
+    // Current top-level member
+    std::string member_;
+    // Current element name
+    std::string name_;
+    // Set after a skipped key until its value starts
+    bool skipping_{false};
+    // Depth within a skipped value
+    std::size_t skip_{0};
+};
+}  // namespace
+
+void smgl::WriteMetadata(
+    const filesystem::path& path, const Metadata& m, MetadataFormat format)
+{
+    if (format == MetadataFormat::Auto) {
+        format = FormatFromExtension(path);
+    }
+
     // TODO: string() not needed with std::filesystem
-    std::ofstream o(path.string());
-    o << std::setw(4) << m << std::endl;
+    if (format == MetadataFormat::JSON) {
+        std::ofstream o(path.string());
+        o << std::setw(4) << m << std::endl;
+        return;
+    }
+
+    std::vector<std::uint8_t> bytes;
+    switch (format) {
+        case MetadataFormat::CBOR:
+            bytes = Metadata::to_cbor(m);
+            break;
+        case MetadataFormat::MsgPack:
+            bytes = Metadata::to_msgpack(m);
+            break;
+        default:
+            bytes = Metadata::to_ubjson(m);
+            break;
+    }
+    std::ofstream o(path.string(), std::ios::binary);
+    o.write(
+        reinterpret_cast<const char*>(bytes.data()),
+        static_cast<std::streamsize>(bytes.size()));
+}
+
+auto smgl::LoadMetadata(const filesystem::path& path, MetadataFormat format)
+    -> Metadata
+{
+    std::ifstream i(path.string(), std::ios::binary);
+    if (format == MetadataFormat::JSON) {
+        Metadata m;
+        i >> m;
+        return m;
+    }
+
+    std::vector<std::uint8_t> bytes{
+        std::istreambuf_iterator<char>(i), std::istreambuf_iterator<char>()};
+    if (format == MetadataFormat::Auto) {
+        format = FormatFromContents(bytes.data(), bytes.size());
+    }
+    switch (format) {
+        case MetadataFormat::CBOR:
+            return Metadata::from_cbor(bytes);
+        case MetadataFormat::MsgPack:
+            return Metadata::from_msgpack(bytes);
+        case MetadataFormat::UBJSON:
+            return Metadata::from_ubjson(bytes);
+        default:
+            return Metadata::parse(bytes);
+    }
+}
+
+auto detail::MetadataVisitor::stream(const std::string& /*unused*/) -> bool
+{
+    return false;
+}
+
+auto detail::MetadataVisitor::keep(
+    const std::string& /*unused*/, const std::string& /*unused*/) -> bool
+{
+    return true;
+}
+
+void detail::MetadataVisitor::member(
+    const std::string& /*unused*/, Metadata&& /*unused*/)
+{
+}
+
+void detail::MetadataVisitor::element(
+    const std::string& /*unused*/,
+    const std::string& /*unused*/,
+    Metadata&& /*unused*/)
+{
 }
 
-auto smgl::LoadMetadata(const filesystem::path& path) -> Metadata
+void smgl::detail::VisitMetadata(
+    const filesystem::path& path,
+    MetadataVisitor& visitor,
+    MetadataFormat format)
 {
-    Metadata m;
-    std::ifstream i(path.string());
-    i >> m;
-    return m;
-}
\ No newline at end of file
+    std::ifstream i(path.string(), std::ios::binary);
+    if (not i) {
+        throw std::runtime_error("Failed to open " + path.string());
+    }
+    if (format == MetadataFormat::Auto) {
+        format = FormatFromStream(i);
+    }
+    VisitorSax sax(visitor);
+    Metadata::sax_parse(i, &sax, InputFormat(format));
+}
+
+auto detail::MetadataJournal::Path(const filesystem::path& json)
+    -> filesystem::path
+{
+    auto p = json;
+    p += ".journal";
+    return p;
+}
+
+auto detail::MetadataJournal::Replay(const filesystem::path& json)
+    -> Metadata
+{
+    auto nodes = Metadata::object();
+    std::ifstream log(Path(json).string());
+    std::string line;
+    while (std::getline(log, line)) {
+        auto record = Metadata::parse(line, nullptr, false);
+        if (record.is_discarded()) {
+            break;
+        }
+        nodes[record["uuid"].get<std::string>()] = record["node"];
+    }
+    return nodes;
+}
+
+void detail::MetadataJournal::open(
+    const filesystem::path& json, Metadata meta, MetadataFormat format)
+{
+    // Truncate the old journal first so it is never replayed onto new state
+    log_.open(Path(json).string(), std::ios::trunc);
+    if (not log_) {
+        throw std::runtime_error("Failed to open " + Path(json).string());
+    }
+    json_ = json;
+    meta_ = std::move(meta);
+    format_ = format;
+    WriteMetadata(json_, meta_, format_);
+}
+
+auto detail::MetadataJournal::isOpen() const -> bool { return log_.is_open(); }
+
+void detail::MetadataJournal::append(const std::string& uuid, Metadata node)
+{
+    Metadata record{{"uuid", uuid}, {"node", node}};
+    log_ << record.dump() << '\n' << std::flush;
+    meta_["nodes"][uuid] = std::move(node);
+}
+
+void detail::MetadataJournal::compact()
+{
+    if (not log_.is_open()) {
+        return;
+    }
+    WriteMetadata(json_, meta_, format_);
+    log_.close();
+    filesystem::remove(Path(json_));
+}
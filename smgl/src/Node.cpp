@@ -1,5 +1,7 @@
 #include "smgl/Node.hpp"
 
+#include <algorithm>
+
 #include "smgl/LoggingPrivate.hpp"
 #include "smgl/Utilities.hpp"
 
@@ -20,7 +22,11 @@ void Node::update()
         LogDebug("[Node::update]", "Ports have no updates");
         return;
     }
+    compute_and_send_();
+}
 
+void Node::compute_and_send_()
+{
     // Compute
     LogDebug("[Node::update]", "Notifying output ports");
     notify_output_ports_(Port::State::Waiting);
@@ -185,29 +191,30 @@ auto Node::state() -> Node::State
         return state_;
     }
 
-    // Check state of input ports
-    auto queued = false;
-    for (const auto& ip : inputs_by_name_) {
-        auto status = ip.second->state();
-
-        // Can break early if any are waiting
-        if (status == Port::State::Waiting) {
-            return State::Waiting;
-        }
-
-        // Give all ports a chance to be waiting, so keep track
-        // of whether any port is queued
-        queued |= status == Port::State::Queued;
+    // Any waiting port means an upstream dependency has not resolved
+    if (waiting_inputs_ > 0) {
+        return State::Waiting;
     }
 
-    // Return port statuses
-    if (queued) {
+    // Otherwise, ready if any port is queued
+    if (queued_inputs_ > 0) {
         return State::Ready;
     } else {
         return State::Idle;
     }
 }
 
+auto Node::blocked() const -> bool
+{
+    return std::any_of(outputs_.begin(), outputs_.end(), [](const auto& p) {
+        return p->blocked();
+    });
+}
+
+auto Node::tick() const -> std::size_t { return tick_; }
+
+auto Node::cancelled() const -> bool { return cancelled_ and *cancelled_; }
+
 auto Node::serialize_(bool useCache, const filesystem::path& cacheDir)
     -> Metadata
 {
@@ -221,29 +228,44 @@ void Node::deserialize_(const Metadata& data, const filesystem::path& cacheDir)
 auto Node::update_input_ports_() -> bool
 {
     auto res = false;
-    for (const auto& p : inputs_by_name_) {
-        res |= p.second->update();
+    for (const auto& p : inputs_) {
+        res |= p->update();
     }
     return res;
 }
 
 void Node::notify_output_ports_(Port::State s)
 {
-    for (const auto& p : outputs_by_name_) {
-        p.second->notify(s);
+    for (const auto& p : outputs_) {
+        p->notify(s);
     }
 }
 
 auto Node::update_output_ports_() -> bool
 {
     auto res = false;
-    for (const auto& p : outputs_by_name_) {
-        p.second->setState(Port::State::Idle);
-        res |= p.second->update();
+    for (const auto& p : outputs_) {
+        p->setState(Port::State::Idle);
+        res |= p->update();
     }
     return res;
 }
 
+void Node::input_state_changed_(Port::State from, Port::State to)
+{
+    if (from == Port::State::Waiting) {
+        waiting_inputs_--;
+    } else if (from == Port::State::Queued) {
+        queued_inputs_--;
+    }
+
+    if (to == Port::State::Waiting) {
+        waiting_inputs_++;
+    } else if (to == Port::State::Queued) {
+        queued_inputs_++;
+    }
+}
+
 auto smgl::DeregisterNode(const std::string& name) -> bool
 {
     return detail::NodeFactoryType::Instance().Deregister(name);
@@ -1,7 +1,17 @@
 #include "smgl/Ports.hpp"
 
+#include <atomic>
+
+#include "smgl/Node.hpp"
+
 using namespace smgl;
 
+namespace
+{
+// Incremented on every connect/disconnect
+std::atomic<std::uint64_t> connectionEpoch{0};
+}  // namespace
+
 ///////////////////////////
 ///// Port Connection /////
 ///////////////////////////
@@ -18,6 +28,11 @@ void smgl::disconnect(Output& op, Input& ip)
     ip.disconnect(&op);
 }
 
+auto smgl::detail::ConnectionEpoch() -> std::uint64_t
+{
+    return connectionEpoch;
+}
+
 void smgl::operator>>(Output& op, Input& ip) { connect(op, ip); }
 
 void smgl::operator<<(Input& ip, Output& op) { connect(op, ip); }
@@ -40,6 +55,8 @@ void Port::setState(State s) { state_ = s; }
 
 Output::Output() : Port(State::Waiting) {}
 
+auto Output::blocked() const -> bool { return false; }
+
 /////////////////
 ///// Input /////
 /////////////////
@@ -49,14 +66,14 @@ Input::Input() : Port(State::Idle) {}
 Input::~Input()
 {
     if (src_) {
-        src_->disconnect(this);
+        release_(src_);
     }
 }
 
 auto Input::getConnections() const -> std::vector<Connection>
 {
     if (src_) {
-        return {{src_->parent_, src_, parent_, const_cast<Input*>(this)}};
+        return {connection_(src_)};
     } else {
         return {};
     }
@@ -64,13 +81,47 @@ auto Input::getConnections() const -> std::vector<Connection>
 
 auto Input::numConnections() const -> size_t { return (src_) ? 1 : 0; }
 
-void Input::connect(Output* op) { src_ = op; }
+void Input::setState(State s)
+{
+    auto old = state_.exchange(s);
+    if (parent_ and old != s) {
+        parent_->input_state_changed_(old, s);
+    }
+}
+
+void Input::connect(Output* op)
+{
+    add_source_(op);
+    connectionEpoch++;
+}
 
 void Input::disconnect(Output* op)
+{
+    if (remove_source_(op)) {
+        connectionEpoch++;
+    }
+}
+
+void Input::add_source_(Output* op) { src_ = op; }
+
+auto Input::remove_source_(Output* op) -> bool
 {
     if (src_ and src_ == op) {
         src_ = nullptr;
+        return true;
     }
+    return false;
+}
+
+auto Input::connection_(Output* op) const -> Connection
+{
+    return {op->parent_, op, parent_, const_cast<Input*>(this)};
+}
+
+void Input::release_(Output* op)
+{
+    op->disconnect(this);
+    connectionEpoch++;
 }
 
 auto Input::operator=(Output& op) -> Input&
@@ -0,0 +1,118 @@
+#include "smgl/ThreadPool.hpp"
+
+using namespace smgl;
+
+namespace
+{
+// Identifies the pool and queue owned by the current worker thread
+thread_local const ThreadPool* tlsPool{nullptr};
+thread_local std::size_t tlsIdx{0};
+}  // namespace
+
+ThreadPool::ThreadPool(std::size_t numThreads)
+{
+    if (numThreads == 0) {
+        numThreads = DefaultThreadCount();
+    }
+
+    queues_.reserve(numThreads);
+    for (std::size_t i = 0; i < numThreads; i++) {
+        queues_.emplace_back(new WorkQueue);
+    }
+
+    workers_.reserve(numThreads);
+    for (std::size_t i = 0; i < numThreads; i++) {
+        workers_.emplace_back(&ThreadPool::run_, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& w : workers_) {
+        w.join();
+    }
+}
+
+auto ThreadPool::size() const -> std::size_t { return workers_.size(); }
+
+void ThreadPool::submit(Task task)
+{
+    // Workers push to their own queue, everyone else distributes
+    std::size_t idx{0};
+    if (tlsPool == this) {
+        idx = tlsIdx;
+    } else {
+        idx = next_++ % queues_.size();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues_[idx]->mutex);
+        queues_[idx]->tasks.emplace_back(std::move(task));
+    }
+
+    // Increment under the sleep lock so that waiting workers cannot miss it
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_++;
+    }
+    cv_.notify_one();
+}
+
+auto ThreadPool::DefaultThreadCount() -> std::size_t
+{
+    auto n = std::thread::hardware_concurrency();
+    return (n == 0) ? 1 : n;
+}
+
+void ThreadPool::run_(std::size_t idx)
+{
+    tlsPool = this;
+    tlsIdx = idx;
+
+    Task task;
+    while (true) {
+        if (pop_(idx, task) or steal_(idx, task)) {
+            pending_--;
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return stop_ or pending_ > 0; });
+        if (stop_ and pending_ == 0) {
+            return;
+        }
+    }
+}
+
+auto ThreadPool::pop_(std::size_t idx, Task& task) -> bool
+{
+    auto& q = *queues_[idx];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) {
+        return false;
+    }
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+}
+
+auto ThreadPool::steal_(std::size_t idx, Task& task) -> bool
+{
+    for (std::size_t i = 1; i < queues_.size(); i++) {
+        auto& q = *queues_[(idx + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (not q.tasks.empty()) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
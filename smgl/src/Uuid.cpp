@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <array>
+#include <cstring>
 #include <iomanip>
 #include <random>
 #include <regex>
@@ -67,6 +68,17 @@ auto Uuid::string() const -> std::string
     return ss.str();
 }
 
+auto Uuid::hash() const noexcept -> std::size_t
+{
+    // UUIDv4 bytes are mostly random, so mixing the two halves is enough
+    std::uint64_t lo{0};
+    std::uint64_t hi{0};
+    std::memcpy(&lo, buffer_.data(), sizeof(lo));
+    std::memcpy(&hi, buffer_.data() + sizeof(lo), sizeof(hi));
+    lo ^= hi + 0x9e3779b97f4a7c15ULL + (lo << 6U) + (lo >> 2U);
+    return static_cast<std::size_t>(lo);
+}
+
 auto Uuid::short_string() const -> std::string
 {
     std::stringstream ss;
@@ -114,9 +126,10 @@ auto Uuid::Uuid4() -> Uuid
     // Make new uuid
     Uuid uuid;
 
-    // Create the random engine and distribution
-    static auto rand = detail::SeededRandomEngine();
-    static std::uniform_int_distribution<Uuid::Byte> dist;
+    // Create the random engine and distribution. One engine per thread so
+    // that Nodes and Ports can be constructed concurrently.
+    thread_local auto rand = detail::SeededRandomEngine();
+    thread_local std::uniform_int_distribution<Uuid::Byte> dist;
 
     // Generate random bytes
     for (auto& v : uuid.buffer_) {
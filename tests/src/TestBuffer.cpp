@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include "smgl/Buffer.hpp"
+#include "smgl/Graph.hpp"
+#include "smgl/Node.hpp"
+#include "smgl/Ports.hpp"
+#include "smgl/filesystem.hpp"
+
+using namespace smgl;
+namespace fs = smgl::filesystem;
+
+namespace
+{
+class BufferCachingNode : public Node
+{
+public:
+    BufferCachingNode() : Node{true} { registerPort("buffer", buffer); }
+
+    InputPort<Buffer<float>> buffer{&buffer_};
+    Buffer<float> buffer_;
+
+private:
+    Metadata serialize_(bool useCache, const fs::path& cacheDir) override
+    {
+        if (useCache) {
+            WriteBuffer(cacheDir / "buffer.raw", buffer_);
+        }
+        return {{"cacheFile", "buffer.raw"}};
+    }
+
+    void deserialize_(const Metadata& data, const fs::path& cacheDir) override
+    {
+        auto file = data["cacheFile"].get<std::string>();
+        buffer_ = LoadBuffer<float>(cacheDir / file);
+    }
+};
+}  // namespace
+
+TEST(Buffer, Heap)
+{
+    Buffer<float> buffer(1000, 1.F);
+    EXPECT_EQ(buffer.size(), 1000);
+    EXPECT_EQ(buffer.bytes(), 1000 * sizeof(float));
+    EXPECT_EQ(buffer.storage(), BufferStorage::Heap);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(buffer.data()) % 64, 0);
+    EXPECT_EQ(std::accumulate(buffer.begin(), buffer.end(), 0.F), 1000.F);
+
+    Buffer<float> empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(empty.begin(), empty.end());
+
+    // Sizes which overflow in bytes are rejected
+    constexpr auto tooLarge = std::numeric_limits<std::size_t>::max() / 2;
+    EXPECT_THROW(Buffer<float>{tooLarge}, std::length_error);
+    EXPECT_THROW(Buffer<float>::HugePages(tooLarge), std::length_error);
+}
+
+TEST(Buffer, SharedViews)
+{
+    Buffer<int> buffer(100);
+    std::iota(buffer.begin(), buffer.end(), 0);
+
+    // Copies and views share memory
+    auto copy = buffer;
+    auto view = buffer.view(10, 20);
+    EXPECT_EQ(buffer.use_count(), 3);
+    EXPECT_EQ(copy.data(), buffer.data());
+    EXPECT_EQ(view.size(), 20);
+    EXPECT_EQ(view[0], 10);
+    view[0] = -1;
+    EXPECT_EQ(buffer[10], -1);
+    EXPECT_THROW(buffer.view(90, 20), std::out_of_range);
+
+    // Clones do not
+    auto clone = buffer.clone();
+    clone[10] = 10;
+    EXPECT_EQ(buffer[10], -1);
+    EXPECT_EQ(clone.use_count(), 1);
+}
+
+TEST(Buffer, HugePages)
+{
+    auto buffer = Buffer<double>::HugePages(1 << 20);
+    EXPECT_EQ(buffer.storage(), BufferStorage::HugePages);
+    EXPECT_EQ(buffer.size(), 1 << 20);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(buffer.data()) % 64, 0);
+    EXPECT_EQ(buffer[buffer.size() - 1], 0.0);
+}
+
+TEST(Buffer, MapFile)
+{
+    fs::path file{"TestBuffer_MapFile.raw"};
+    {
+        auto buffer = Buffer<std::uint16_t>::MapFile(file, 4096);
+        EXPECT_EQ(buffer.storage(), BufferStorage::File);
+        EXPECT_EQ(buffer.path(), file);
+        std::iota(buffer.begin(), buffer.end(), 0);
+    }
+    EXPECT_EQ(fs::file_size(file), 4096 * sizeof(std::uint16_t));
+
+    auto buffer = Buffer<std::uint16_t>::OpenFile(file);
+    EXPECT_EQ(buffer.size(), 4096);
+    EXPECT_EQ(buffer[4095], 4095);
+    EXPECT_TRUE(buffer.sharedFile());
+
+    // Changes to a copy-on-write map are not written to the file
+    auto copy = Buffer<std::uint16_t>::OpenFileCopy(file);
+    EXPECT_EQ(copy.storage(), BufferStorage::File);
+    EXPECT_FALSE(copy.sharedFile());
+    copy[0] = 1000;
+    copy.sync();
+    EXPECT_EQ(buffer[0], 0);
+    EXPECT_EQ(Buffer<std::uint16_t>::OpenFileCopy(file)[0], 0);
+
+    constexpr auto tooLarge = std::numeric_limits<std::size_t>::max() / 2;
+    EXPECT_THROW(
+        Buffer<std::uint16_t>::MapFile(file, tooLarge), std::length_error);
+    fs::remove(file);
+}
+
+TEST(Buffer, PortsShareMemory)
+{
+    Buffer<float> source(1 << 20);
+    OutputPort<Buffer<float>> output(&source);
+    Buffer<float> resultA;
+    Buffer<float> resultB;
+    InputPort<Buffer<float>> inputA(&resultA);
+    InputPort<Buffer<float>> inputB(&resultB);
+    connect(output, inputA);
+    connect(output, inputB);
+    output.update();
+    inputA.update();
+    inputB.update();
+    EXPECT_EQ(resultA.data(), source.data());
+    EXPECT_EQ(resultB.data(), source.data());
+}
+
+TEST(Buffer, Cache)
+{
+    RegisterNode<BufferCachingNode>();
+
+    fs::path cacheFile{"TestBuffer_Cache.json"};
+    Graph graph;
+    graph.setEnableCache(true);
+    graph.setCacheFile(cacheFile);
+    auto node = graph.insertNode<BufferCachingNode>();
+    Buffer<float> data(256);
+    std::iota(data.begin(), data.end(), 0.F);
+    node->buffer(data, true);
+    graph.update();
+
+    // The cached buffer is loaded as a file map
+    auto clone = Graph::Load(cacheFile);
+    auto nodeClone =
+        std::dynamic_pointer_cast<BufferCachingNode>(clone[node->uuid()]);
+    ASSERT_TRUE(nodeClone);
+    const auto& loaded = nodeClone->buffer_;
+    EXPECT_EQ(loaded.storage(), BufferStorage::File);
+    EXPECT_FALSE(loaded.sharedFile());
+    ASSERT_EQ(loaded.size(), data.size());
+    EXPECT_TRUE(std::equal(data.begin(), data.end(), loaded.begin()));
+
+    // Editing the loaded buffer does not modify the cache
+    loaded[255] = -1.F;
+    EXPECT_EQ(LoadBuffer<float>(loaded.path())[255], 255.F);
+
+    // Until it is saved, which leaves the loaded buffer valid
+    WriteBuffer(loaded.path(), loaded);
+    EXPECT_EQ(LoadBuffer<float>(loaded.path())[255], -1.F);
+    EXPECT_EQ(loaded[0], 0.F);
+
+    DeregisterNode<BufferCachingNode>();
+    fs::remove_all(graph.cacheDir());
+    fs::remove(cacheFile);
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "smgl/CacheWriter.hpp"
+
+using namespace smgl;
+
+TEST(CacheWriter, RunsInOrder)
+{
+    std::vector<int> order;
+    CacheWriter writer(4);
+    EXPECT_EQ(writer.capacity(), 4);
+    for (int i = 0; i < 100; i++) {
+        writer.submit([&order, i]() { order.push_back(i); });
+    }
+    writer.flush();
+    ASSERT_EQ(order.size(), 100);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(order[i], i);
+    }
+}
+
+TEST(CacheWriter, Backpressure)
+{
+    std::atomic<bool> release{false};
+    std::atomic<int> submitted{0};
+    CacheWriter writer(1);
+
+    // The first task occupies the writer and the second fills the queue
+    auto wait = [&release]() {
+        while (not release) {
+            std::this_thread::yield();
+        }
+    };
+    std::thread producer([&]() {
+        for (int i = 0; i < 3; i++) {
+            writer.submit(wait);
+            submitted++;
+        }
+    });
+    while (submitted < 2) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(submitted, 2);
+
+    release = true;
+    producer.join();
+    writer.flush();
+    EXPECT_EQ(submitted, 3);
+}
+
+TEST(CacheWriter, FlushRethrows)
+{
+    CacheWriter writer;
+    int count{0};
+    writer.submit([]() { throw std::runtime_error("write failed"); });
+    writer.submit([&count]() { count++; });
+    EXPECT_THROW(writer.flush(), std::runtime_error);
+    EXPECT_EQ(count, 1);
+
+    // Errors are only reported once
+    EXPECT_NO_THROW(writer.flush());
+}
@@ -1,6 +1,10 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <thread>
 #include <vector>
 
 #include "smgl/Graph.hpp"
@@ -217,6 +221,95 @@ TEST(Graph, BasicCachingGraph)
     DeregisterNode<CacheNode>();
 }
 
+TEST(Graph, CacheJournal)
+{
+    // Setup nodes
+    using SourceNode = test::ClassWrapperNode<int>;
+    using SumOpNode = test::AdditionNode<int>;
+    RegisterNode<SourceNode>();
+    RegisterNode<SumOpNode>();
+
+    // Build graph
+    fs::path cacheFile{"TestGraph_CacheJournal.json"};
+    auto journalFile = detail::MetadataJournal::Path(cacheFile);
+    Graph graph;
+    graph.setEnableCache(true);
+    graph.setCacheFile(cacheFile);
+    auto lhs = graph.insertNode<SourceNode>();
+    auto rhs = graph.insertNode<SourceNode>();
+    auto sumOp = graph.insertNode<SumOpNode>();
+    lhs->set(1);
+    rhs->set(1);
+    connect(lhs->get, sumOp->lhs);
+    connect(rhs->get, sumOp->rhs);
+    graph.update();
+
+    // The journal is compacted into the cache file
+    auto uuid = sumOp->uuid().string();
+    EXPECT_FALSE(fs::exists(journalFile));
+    auto meta = LoadMetadata(cacheFile);
+    EXPECT_EQ(meta["nodes"][uuid]["data"]["result"], 2);
+
+    // Simulate an update which stops after one Node
+    {
+        detail::MetadataJournal journal;
+        journal.open(cacheFile, meta);
+        auto node = meta["nodes"][uuid];
+        node["data"]["result"] = 3;
+        journal.append(uuid, node);
+    }
+    std::ofstream(journalFile.string(), std::ios::app) << R"({"uuid":)";
+    EXPECT_TRUE(fs::exists(journalFile));
+
+    // Loading recovers the recorded Node and skips the partial record
+    auto clone = Graph::Load(cacheFile);
+    auto sumClone = std::dynamic_pointer_cast<SumOpNode>(clone[sumOp->uuid()]);
+    EXPECT_EQ(sumClone->result(), 3);
+
+    // Saving supersedes the journal
+    Graph::Save(cacheFile, graph);
+    EXPECT_FALSE(fs::exists(journalFile));
+
+    DeregisterNode<SourceNode>();
+    DeregisterNode<SumOpNode>();
+}
+
+TEST(Graph, AsyncCache)
+{
+    using SourceNode = test::ClassWrapperNode<int>;
+    using SumOpNode = test::AdditionNode<int>;
+    RegisterNode<SourceNode>();
+    RegisterNode<SumOpNode>();
+
+    // Build graph
+    fs::path cacheFile{"TestGraph_AsyncCache.json"};
+    Graph graph;
+    graph.setEnableCache(true);
+    graph.setCacheFile(cacheFile);
+    graph.setAsyncCache(true);
+    graph.setNumThreads(2);
+    EXPECT_TRUE(graph.asyncCache());
+    auto lhs = graph.insertNode<SourceNode>();
+    auto rhs = graph.insertNode<SourceNode>();
+    auto sumOp = graph.insertNode<SumOpNode>();
+    connect(lhs->get, sumOp->lhs);
+    connect(rhs->get, sumOp->rhs);
+
+    // Queue several updates before waiting for the cache
+    auto uuid = sumOp->uuid().string();
+    for (int i = 1; i <= 5; i++) {
+        lhs->set(i);
+        rhs->set(i);
+        graph.update();
+    }
+    graph.flushCache();
+    EXPECT_FALSE(fs::exists(detail::MetadataJournal::Path(cacheFile)));
+    EXPECT_EQ(LoadMetadata(cacheFile)["nodes"][uuid]["data"]["result"], 10);
+
+    DeregisterNode<SourceNode>();
+    DeregisterNode<SumOpNode>();
+}
+
 TEST(Graph, SerializationDeserialization)
 {
     // Setup nodes
@@ -275,6 +368,229 @@ TEST(Graph, SerializationDeserialization)
     DeregisterNode<SumOpNode>();
 }
 
+TEST(Graph, BinaryFormats)
+{
+    using SourceNode = test::ClassWrapperNode<int>;
+    using SumOpNode = test::AdditionNode<int>;
+    RegisterNode<SourceNode>();
+    RegisterNode<SumOpNode>();
+
+    Graph g;
+    auto lhs = g.insertNode<SourceNode>();
+    auto rhs = g.insertNode<SourceNode>();
+    auto sumOp = g.insertNode<SumOpNode>();
+    lhs->set(2);
+    rhs->set(3);
+    connect(lhs->get, sumOp->lhs);
+    connect(rhs->get, sumOp->rhs);
+    g.update();
+
+    // Format is selected by extension and detected on load
+    fs::path jsonFile{"TestGraph_BinaryFormats.json"};
+    Graph::Save(jsonFile, g);
+    for (const auto* ext : {".cbor", ".msgpack", ".ubj"}) {
+        fs::path file{std::string("TestGraph_BinaryFormats") + ext};
+        Graph::Save(file, g);
+        EXPECT_LT(fs::file_size(file), fs::file_size(jsonFile)) << ext;
+        EXPECT_EQ(LoadMetadata(file), LoadMetadata(jsonFile)) << ext;
+        EXPECT_TRUE(Graph::CheckRegistration(file).empty());
+
+        auto clone = Graph::Load(file);
+        auto sumClone =
+            std::dynamic_pointer_cast<SumOpNode>(clone[sumOp->uuid()]);
+        EXPECT_EQ(sumClone->result(), 5) << ext;
+        fs::remove(file);
+    }
+
+    // Explicit format overrides the extension
+    fs::path dataFile{"TestGraph_BinaryFormats.dat"};
+    Graph::Save(dataFile, g, false, MetadataFormat::MsgPack);
+    auto expected = LoadMetadata(jsonFile);
+    EXPECT_EQ(LoadMetadata(dataFile, MetadataFormat::MsgPack), expected);
+    EXPECT_EQ(LoadMetadata(dataFile), expected);
+    fs::remove(dataFile);
+
+    // Binary cache files
+    fs::path cacheFile{"TestGraph_BinaryFormats_cache.json"};
+    g.setEnableCache(true);
+    g.setCacheFile(cacheFile);
+    g.setCacheFormat(MetadataFormat::CBOR);
+    g.update();
+    auto cached = LoadMetadata(cacheFile);
+    EXPECT_EQ(cached["nodes"][sumOp->uuid().string()]["data"]["result"], 5);
+    EXPECT_THROW(LoadMetadata(cacheFile, MetadataFormat::JSON), std::exception);
+
+    DeregisterNode<SourceNode>();
+    DeregisterNode<SumOpNode>();
+}
+
+TEST(Graph, StreamingLoad)
+{
+    using SourceNode = test::ClassWrapperNode<int>;
+    using SumOpNode = test::AdditionNode<int>;
+    RegisterNode<SourceNode>();
+    RegisterNode<SumOpNode>();
+
+    Graph g;
+    auto lhs = g.insertNode<SourceNode>();
+    auto rhs = g.insertNode<SourceNode>();
+    auto sumOp = g.insertNode<SumOpNode>();
+    lhs->set(2);
+    rhs->set(3);
+    connect(lhs->get, sumOp->lhs);
+    connect(rhs->get, sumOp->rhs);
+    g.update();
+
+    // Move the header after the nodes and connections
+    fs::path file{"TestGraph_StreamingLoad.json"};
+    auto meta = Graph::Serialize(g);
+    Metadata reordered{
+        {"nodes", meta["nodes"]}, {"connections", meta["connections"]}};
+    for (const auto& member : meta.items()) {
+        if (not reordered.contains(member.key())) {
+            reordered[member.key()] = member.value();
+        }
+    }
+    WriteMetadata(file, reordered);
+
+    // Nodes are held until the header has been read
+    auto clone = Graph::Load(file);
+    EXPECT_EQ(clone.uuid(), g.uuid());
+    EXPECT_EQ(clone.size(), 3);
+    auto sumClone = std::dynamic_pointer_cast<SumOpNode>(clone[sumOp->uuid()]);
+    EXPECT_EQ(sumClone->result(), 5);
+    EXPECT_EQ(
+        clone[lhs->uuid()]->getOutputPort("get").numConnections(), 1);
+
+    // Only the requested fields of streamed elements are read
+    struct TypeVisitor : public detail::MetadataVisitor {
+        std::vector<Metadata> nodes;
+        auto stream(const std::string& key) -> bool override
+        {
+            return key == "nodes";
+        }
+        auto keep(const std::string& /*key*/, const std::string& field)
+            -> bool override
+        {
+            return field == "type";
+        }
+        void element(
+            const std::string& key,
+            const std::string& name,
+            Metadata&& value) override
+        {
+            EXPECT_EQ(key, "nodes");
+            EXPECT_FALSE(name.empty());
+            nodes.emplace_back(std::move(value));
+        }
+    } visitor;
+    detail::VisitMetadata(file, visitor);
+    ASSERT_EQ(visitor.nodes.size(), 3);
+    for (const auto& n : visitor.nodes) {
+        EXPECT_EQ(n.size(), 1);
+        EXPECT_TRUE(n.contains("type"));
+    }
+
+    // Missing header members are reported
+    reordered.erase("uuid");
+    WriteMetadata(file, reordered);
+    EXPECT_THROW(Graph::Load(file), Metadata::exception);
+    fs::remove(file);
+
+    DeregisterNode<SourceNode>();
+    DeregisterNode<SumOpNode>();
+}
+
+TEST(Graph, ParallelSerialize)
+{
+    using SourceNode = test::ClassWrapperNode<std::string>;
+    using CacheNode = test::StringCachingNode;
+    RegisterNode<SourceNode>("smgl::test::ClassWrapperNode<std::string>");
+    RegisterNode<CacheNode>();
+
+    // Many caching nodes
+    Graph graph;
+    std::vector<std::shared_ptr<CacheNode>> caches;
+    for (int i = 0; i < 64; i++) {
+        auto src = graph.insertNode<SourceNode>();
+        auto cache = graph.insertNode<CacheNode>();
+        src->get >> cache->value;
+        src->set("value " + std::to_string(i));
+        caches.push_back(cache);
+    }
+    graph.update();
+
+    // Parallel and serial serialization produce the same file
+    fs::path serialFile{"TestGraph_ParallelSerialize_Serial.json"};
+    fs::path parallelFile{"TestGraph_ParallelSerialize_Parallel.json"};
+    Graph::Save(serialFile, graph, true);
+    graph.setNumThreads(4);
+    Graph::Save(parallelFile, graph, true);
+    auto serial = LoadMetadata(serialFile);
+    auto parallel = LoadMetadata(parallelFile);
+    serial.erase("cacheDir");
+    parallel.erase("cacheDir");
+    EXPECT_EQ(serial.dump(), parallel.dump());
+
+    // Every node wrote its cache
+    for (std::size_t i = 0; i < caches.size(); i++) {
+        auto uuid = caches[i]->uuid().string();
+        EXPECT_EQ(
+            LoadCachedValue(parallelFile, uuid), "value " + std::to_string(i));
+    }
+
+    for (const auto& f : {serialFile, parallelFile}) {
+        fs::remove_all(f.parent_path() / (f.stem().string() + "_cache"));
+        fs::remove(f);
+    }
+    DeregisterNode<SourceNode>();
+    DeregisterNode<CacheNode>();
+}
+
+TEST(Graph, ParallelLoad)
+{
+    using SourceNode = test::ClassWrapperNode<std::string>;
+    using CacheNode = test::StringCachingNode;
+    RegisterNode<SourceNode>("smgl::test::ClassWrapperNode<std::string>");
+    RegisterNode<CacheNode>();
+
+    // Many caching nodes
+    Graph graph;
+    std::vector<std::shared_ptr<SourceNode>> sources;
+    for (int i = 0; i < 64; i++) {
+        auto src = graph.insertNode<SourceNode>();
+        auto cache = graph.insertNode<CacheNode>();
+        src->get >> cache->value;
+        src->set("value " + std::to_string(i));
+        sources.push_back(src);
+    }
+    graph.update();
+    fs::path file{"TestGraph_ParallelLoad.json"};
+    Graph::Save(file, graph, true);
+
+    // Nodes are deserialized concurrently and connected afterwards
+    auto clone = Graph::Load(file, 4);
+    EXPECT_EQ(clone.numThreads(), 4);
+    EXPECT_EQ(clone.uuid(), graph.uuid());
+    ASSERT_EQ(clone.size(), graph.size());
+    for (std::size_t i = 0; i < sources.size(); i++) {
+        auto src = std::dynamic_pointer_cast<SourceNode>(
+            clone[sources[i]->uuid()]);
+        ASSERT_TRUE(src);
+        EXPECT_EQ(src->get(), "value " + std::to_string(i));
+        EXPECT_EQ(src->getOutputPort("get").numConnections(), 1);
+    }
+
+    // Errors in the workers are rethrown
+    DeregisterNode<CacheNode>();
+    EXPECT_THROW(Graph::Load(file, 4), unknown_identifier);
+
+    fs::remove_all(graph.cacheDir());
+    fs::remove_all(file.parent_path() / (file.stem().string() + "_cache"));
+    fs::remove(file);
+    DeregisterNode<SourceNode>();
+}
+
 TEST(Graph, CheckRegistration)
 {
     // type aliases
@@ -352,4 +668,751 @@ TEST(Graph, Scheduling)
     // Sum Op must be final node
     auto schedule = Graph::Schedule(g);
     EXPECT_EQ(schedule[2]->uuid(), finalID);
-}
\ No newline at end of file
+}
+
+TEST(Graph, ScheduleInvalidation)
+{
+    using SourceNode = test::PassThroughNode<int>;
+    using SumOpNode = test::AdditionNode<int>;
+
+    Graph g;
+    auto lhs = g.insertNode<SourceNode>(1);
+    auto sumOp = g.insertNode<SumOpNode>();
+    connect(lhs->get, sumOp->lhs);
+
+    // Repeated updates reuse the cached schedule
+    g.update();
+    EXPECT_EQ(sumOp->result(), 1);
+    lhs->set(2);
+    g.update();
+    EXPECT_EQ(sumOp->result(), 2);
+
+    // Inserting a node and connecting it invalidates the schedule
+    auto rhs = g.insertNode<SourceNode>(3);
+    connect(rhs->get, sumOp->rhs);
+    g.update();
+    EXPECT_EQ(sumOp->result(), 5);
+
+    // Disconnecting invalidates the schedule
+    disconnect(rhs->get, sumOp->rhs);
+    rhs->set(10);
+    lhs->set(4);
+    g.update();
+    EXPECT_EQ(sumOp->result(), 7);
+}
+
+TEST(Graph, ScheduleLevels)
+{
+    using SourceNode = test::PassThroughNode<int>;
+    using SumOpNode = test::AdditionNode<int>;
+
+    Graph g;
+    auto a = g.insertNode<SourceNode>(1);
+    auto b = g.insertNode<SourceNode>(2);
+    auto s0 = g.insertNode<SumOpNode>();
+    auto s1 = g.insertNode<SumOpNode>();
+    connect(a->get, s0->lhs);
+    connect(b->get, s0->rhs);
+    connect(s0->result, s1->lhs);
+    connect(a->get, s1->rhs);
+
+    // Each node is one level below its deepest source
+    auto levels = Graph::ScheduleLevels(g);
+    ASSERT_EQ(levels.size(), 3);
+    EXPECT_THAT(levels[0], ::testing::UnorderedElementsAre(a, b));
+    EXPECT_THAT(levels[1], ::testing::ElementsAre(s0));
+    EXPECT_THAT(levels[2], ::testing::ElementsAre(s1));
+}
+
+TEST(Graph, Compile)
+{
+    using SourceNode = test::PassThroughNode<int>;
+    using SumOpNode = test::AdditionNode<int>;
+
+    Graph g;
+    auto a = g.insertNode<SourceNode>(1);
+    auto b = g.insertNode<SourceNode>(2);
+    auto sum = g.insertNode<SumOpNode>();
+    connect(a->get, sum->lhs);
+
+    // Plan is reused until the topology changes
+    auto plan = g.compile();
+    EXPECT_EQ(g.compile(), plan);
+    connect(b->get, sum->rhs);
+    auto newPlan = g.compile();
+    EXPECT_NE(newPlan, plan);
+
+    // Plan indices describe the connections
+    ASSERT_EQ(newPlan->size(), 3);
+    const auto& nodes = newPlan->nodes();
+    auto idx = static_cast<std::size_t>(
+        std::find(nodes.begin(), nodes.end(), sum) - nodes.begin());
+    ASSERT_EQ(idx, 2);
+    EXPECT_EQ(newPlan->level(idx), 1);
+    EXPECT_EQ(newPlan->successors(idx).size(), 0);
+    auto preds = newPlan->predecessors(idx);
+    ASSERT_EQ(preds.size(), 2);
+    std::vector<Node::Pointer> upstream;
+    for (const auto& p : preds) {
+        EXPECT_EQ(newPlan->successors(p).size(), 1);
+        EXPECT_EQ(*newPlan->successors(p).begin(), idx);
+        upstream.push_back(nodes[p]);
+    }
+    EXPECT_THAT(upstream, ::testing::UnorderedElementsAre(a, b));
+
+    // Updates execute the compiled plan
+    g.update();
+    EXPECT_EQ(sum->result(), 3);
+}
+
+TEST(Graph, ScheduleCycle)
+{
+    using PassNode = test::PassThroughNode<int>;
+
+    Graph g;
+    auto src = g.insertNode<PassNode>(1);
+    auto sumOp = g.insertNode<test::AdditionNode<int>>();
+    auto a = g.insertNode<PassNode>();
+    auto b = g.insertNode<PassNode>();
+    connect(src->get, sumOp->lhs);
+    connect(sumOp->result, a->set);
+    connect(a->get, b->set);
+    connect(b->get, sumOp->rhs);
+
+    // Cycle is reported, but not the upstream source
+    try {
+        Graph::Schedule(g);
+        FAIL() << "Expected smgl::cycle_error";
+    } catch (const cycle_error& e) {
+        // Cycle may start at any of its members
+        auto cycle = e.cycle();
+        auto it = std::find(cycle.begin(), cycle.end(), sumOp->uuid());
+        ASSERT_NE(it, cycle.end());
+        std::rotate(cycle.begin(), it, cycle.end());
+        std::vector<Uuid> expected{sumOp->uuid(), a->uuid(), b->uuid()};
+        EXPECT_EQ(cycle, expected);
+    }
+    EXPECT_THROW(g.update(), cycle_error);
+}
+
+TEST(Graph, ScheduleLongChain)
+{
+    using PassNode = test::PassThroughNode<int>;
+
+    // Long chains must not exhaust the stack
+    Graph g;
+    auto first = g.insertNode<PassNode>(1);
+    auto prev = first;
+    for (int i = 0; i < 100000; i++) {
+        auto next = g.insertNode<PassNode>();
+        connect(prev->get, next->set);
+        prev = next;
+    }
+
+    auto schedule = Graph::Schedule(g);
+    ASSERT_EQ(schedule.size(), 100001);
+    EXPECT_EQ(schedule.front(), first);
+    EXPECT_EQ(schedule.back(), prev);
+}
+
+TEST(Graph, ParallelComplexGraph)
+{
+    // Setup nodes + graph
+    using SourceNode = test::PassThroughNode<int>;
+    auto a = std::make_shared<SourceNode>(3);
+    auto b = std::make_shared<SourceNode>(5);
+    auto c = std::make_shared<SourceNode>(6);
+    auto d = std::make_shared<SourceNode>(4);
+    auto e = std::make_shared<SourceNode>(6);
+    auto final = std::make_shared<SourceNode>(0);
+
+    using SumOp = test::AdditionNode<int>;
+    using SubOp = test::SubtractionNode<int>;
+    auto a0 = std::make_shared<SumOp>();
+    auto a1 = std::make_shared<SumOp>();
+    auto a2 = std::make_shared<SumOp>();
+    auto a3 = std::make_shared<SumOp>();
+    auto s0 = std::make_shared<SubOp>();
+    auto s1 = std::make_shared<SubOp>();
+
+    // Build graph
+    Graph graph;
+    graph.setNumThreads(4);
+    EXPECT_EQ(graph.numThreads(), 4);
+    graph.insertNodes(a, b, c, d, e, a0, a1, a2, a3, s0, s1, final);
+
+    // Connections
+    connect(b->get, a0->lhs);
+    connect(c->get, a0->rhs);
+    connect(a0->result, a1->lhs);
+    connect(d->get, a1->rhs);
+    connect(s0->result, a2->lhs);
+    connect(s1->result, a2->rhs);
+    connect(a2->result, a3->lhs);
+    connect(a1->result, a3->rhs);
+    connect(a->get, s0->lhs);
+    connect(a0->result, s0->rhs);
+    connect(a1->result, s1->lhs);
+    connect(e->get, s1->rhs);
+    connect(a3->result, final->set);
+
+    // Update graph and check final value
+    graph.update();
+    EXPECT_EQ(final->get(), 16);
+
+    // Make a change to the inputs and check output
+    b->set(1);
+    c->set(1);
+    graph.update();
+    EXPECT_EQ(final->get(), 7);
+}
+
+TEST(Graph, ParallelWideGraph)
+{
+    using SourceNode = test::PassThroughNode<int>;
+    using MulOp = test::MultiplyNode<int>;
+    using SumOp = test::AdditionNode<int>;
+
+    // One source fanned out to many independent branches which are then
+    // reduced with a chain of sums
+    Graph graph;
+    graph.setNumThreads(0);
+    auto src = graph.insertNode<SourceNode>(2);
+    std::shared_ptr<SumOp> last;
+    constexpr int numBranches{64};
+    for (int i = 0; i < numBranches; i++) {
+        auto mul = graph.insertNode<MulOp>();
+        connect(src->get, mul->lhs);
+        mul->rhs(i);
+
+        auto sum = graph.insertNode<SumOp>();
+        connect(mul->result, sum->lhs);
+        if (last) {
+            connect(last->result, sum->rhs);
+        }
+        last = sum;
+    }
+
+    // sum(2 * i) for i in [0, numBranches)
+    graph.update();
+    EXPECT_EQ(last->result(), numBranches * (numBranches - 1));
+
+    src->set(1);
+    graph.update();
+    EXPECT_EQ(last->result(), numBranches * (numBranches - 1) / 2);
+}
+
+TEST(Graph, PartialUpdate)
+{
+    using SourceNode = test::PassThroughNode<int>;
+    using SumOp = test::AdditionNode<int>;
+    using SubOp = test::SubtractionNode<int>;
+
+    for (std::size_t threads : {1, 4}) {
+        // Two sinks which share a source
+        Graph graph;
+        graph.setNumThreads(threads);
+        auto a = graph.insertNode<SourceNode>(3);
+        auto b = graph.insertNode<SourceNode>(2);
+        auto c = graph.insertNode<SourceNode>(1);
+        auto sum = graph.insertNode<SumOp>();
+        auto sub = graph.insertNode<SubOp>();
+        connect(a->get, sum->lhs);
+        connect(b->get, sum->rhs);
+        connect(a->get, sub->lhs);
+        connect(c->get, sub->rhs);
+
+        // Only the sum and its sources are updated
+        graph.update({sum});
+        EXPECT_EQ(sum->result(), 5);
+        EXPECT_EQ(sub->result(), 0);
+
+        // Skipped nodes keep their queued updates
+        EXPECT_EQ(c->state(), Node::State::Ready);
+        EXPECT_EQ(sub->state(), Node::State::Ready);
+        graph.update();
+        EXPECT_EQ(sum->result(), 5);
+        EXPECT_EQ(sub->result(), 2);
+    }
+
+    // Targets must be in the graph
+    Graph graph;
+    auto n = std::make_shared<SourceNode>();
+    EXPECT_THROW(graph.update({n}), std::invalid_argument);
+    EXPECT_THROW(graph.update({nullptr}), std::invalid_argument);
+}
+
+namespace
+{
+class ThrowingNode : public Node
+{
+public:
+    InputPort<int> in{&value_};
+    ThrowingNode()
+    {
+        registerPort("in", in);
+        compute = []() { throw std::runtime_error("compute failed"); };
+    }
+
+private:
+    int value_{0};
+};
+
+class CountingNode : public Node
+{
+public:
+    InputPort<int> in{&value_};
+    int count{0};
+    CountingNode()
+    {
+        registerPort("in", in);
+        compute = [this]() { count++; };
+    }
+
+private:
+    int value_{0};
+};
+
+class RecordingNode : public Node
+{
+public:
+    InputPort<int> in{&value_};
+    std::vector<int> values;
+    std::vector<std::size_t> ticks;
+    RecordingNode()
+    {
+        registerPort("in", in);
+        compute = [this]() {
+            values.push_back(value_);
+            ticks.push_back(tick());
+        };
+    }
+
+private:
+    int value_{0};
+};
+
+class BlockingNode : public Node
+{
+public:
+    InputPort<int> in{&value_};
+    OutputPort<int> out{&value_};
+    std::atomic<bool> started{false};
+    BlockingNode()
+    {
+        registerPort("in", in);
+        registerPort("out", out);
+        compute = [this]() {
+            started = true;
+            while (not cancelled()) {
+                std::this_thread::yield();
+            }
+        };
+    }
+
+private:
+    int value_{0};
+};
+
+class StageNode : public Node
+{
+public:
+    struct Activity {
+        std::atomic<int> active{0};
+        std::atomic<int> peak{0};
+    };
+    InputPort<int> in{&value_};
+    OutputPort<int> out{&value_};
+    explicit StageNode(Activity* activity)
+    {
+        registerPort("in", in);
+        registerPort("out", out);
+        compute = [activity]() {
+            auto active = ++activity->active;
+            auto peak = activity->peak.load();
+            while (active > peak and
+                   not activity->peak.compare_exchange_weak(peak, active)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            activity->active--;
+        };
+    }
+
+private:
+    int value_{0};
+};
+
+class ThumbnailNode : public Node
+{
+public:
+    InputPort<int> in{&value_};
+    OutputPort<int> thumbnail{this, &ThumbnailNode::render};
+    int renders{0};
+    ThumbnailNode()
+    {
+        registerPort("in", in);
+        registerPort("thumbnail", thumbnail);
+        thumbnail.setLazy(true);
+    }
+
+    auto render() -> int
+    {
+        renders++;
+        return value_ * 10;
+    }
+
+private:
+    int value_{0};
+};
+
+class GatherSumNode : public Node
+{
+public:
+    GatherInputPort<int> values{&values_};
+    OutputPort<int> result{&result_};
+    int count{0};
+    GatherSumNode()
+    {
+        registerPort("values", values);
+        registerPort("result", result);
+        compute = [this]() {
+            count++;
+            result_ = std::accumulate(values_.begin(), values_.end(), 0);
+        };
+    }
+
+private:
+    std::vector<int> values_;
+    int result_{0};
+};
+
+class QueueNode : public Node
+{
+public:
+    QueuedInputPort<int, 2> in{this, &QueueNode::receive};
+    std::vector<int> values;
+    QueueNode() { registerPort("in", in); }
+
+    void receive(int v) { values.push_back(v); }
+};
+}  // namespace
+
+TEST(Graph, ParallelUpdateError)
+{
+    using SourceNode = test::PassThroughNode<int>;
+    Graph graph;
+    graph.setNumThreads(2);
+    auto src = graph.insertNode<SourceNode>(1);
+    auto bad = graph.insertNode<ThrowingNode>();
+    connect(src->get, bad->in);
+    EXPECT_THROW(graph.update(), std::runtime_error);
+}
+
+TEST(Graph, CacheErrorDuringUpdateError)
+{
+    using SourceNode = test::PassThroughNode<int>;
+    RegisterNode<SourceNode>();
+    RegisterNode<ThrowingNode>();
+
+    // The cache journal cannot be opened because it is a directory
+    fs::path cacheFile{"TestGraph_CacheErrorDuringUpdateError.json"};
+    auto journalFile = detail::MetadataJournal::Path(cacheFile);
+    fs::create_directory(journalFile);
+    Graph graph;
+    graph.setEnableCache(true);
+    graph.setCacheFile(cacheFile);
+    auto src = graph.insertNode<SourceNode>(1);
+    auto bad = graph.insertNode<ThrowingNode>();
+    connect(src->get, bad->in);
+
+    // The Node's error is reported instead of the cache's
+    try {
+        graph.update();
+        FAIL() << "Expected std::runtime_error";
+    } catch (const std::runtime_error& e) {
+        EXPECT_STREQ(e.what(), "compute failed");
+    }
+
+    DeregisterNode<SourceNode>();
+    DeregisterNode<ThrowingNode>();
+    fs::remove_all(graph.cacheDir());
+    fs::remove_all(journalFile);
+    fs::remove(cacheFile);
+}
+
+TEST(Graph, LazyOutput)
+{
+    using SourceNode = test::PassThroughNode<int>;
+
+    Graph graph;
+    auto src = graph.insertNode<SourceNode>(1);
+    auto thumb = graph.insertNode<ThumbnailNode>();
+    auto other = graph.insertNode<CountingNode>();
+    auto viewer = graph.insertNode<CountingNode>();
+    connect(src->get, thumb->in);
+    connect(src->get, other->in);
+    connect(thumb->thumbnail, viewer->in);
+
+    // The thumbnail is not rendered unless the viewer is updated
+    graph.update({other});
+    EXPECT_EQ(thumb->renders, 0);
+    graph.update({thumb});
+    EXPECT_EQ(thumb->renders, 0);
+    EXPECT_EQ(viewer->state(), Node::State::Ready);
+    graph.update();
+    EXPECT_EQ(thumb->renders, 1);
+    EXPECT_EQ(viewer->count, 1);
+}
+
+TEST(Graph, GatherReduce)
+{
+    using SourceNode = test::PassThroughNode<int>;
+    using MulOp = test::MultiplyNode<int>;
+
+    // Branches which are only known at runtime reduced by a single node
+    Graph graph;
+    graph.setNumThreads(4);
+    auto src = graph.insertNode<SourceNode>(2);
+    auto sum = graph.insertNode<GatherSumNode>();
+    constexpr int numBranches{32};
+    for (int i = 0; i < numBranches; i++) {
+        auto mul = graph.insertNode<MulOp>();
+        connect(src->get, mul->lhs);
+        mul->rhs(i);
+        connect(mul->result, sum->values);
+    }
+    EXPECT_EQ(sum->values.numConnections(), numBranches);
+
+    // sum(2 * i) for i in [0, numBranches)
+    graph.update();
+    EXPECT_EQ(sum->result(), numBranches * (numBranches - 1));
+    EXPECT_EQ(sum->count, 1);
+
+    src->set(1);
+    graph.update();
+    EXPECT_EQ(sum->result(), numBranches * (numBranches - 1) / 2);
+    EXPECT_EQ(sum->count, 2);
+}
+
+TEST(Graph, QueuedBackpressure)
+{
+    using SourceNode = test::PassThroughNode<int>;
+
+    Graph graph;
+    auto src = graph.insertNode<SourceNode>();
+    auto sink = graph.insertNode<QueueNode>();
+    connect(src->get, sink->in);
+
+    // Fill the queue without updating the consumer
+    for (int i = 1; i <= 2; i++) {
+        src->set(i);
+        graph.update({src});
+    }
+    EXPECT_TRUE(src->get.blocked());
+
+    // The blocked producer is deferred instead of blocking the update
+    src->set(3);
+    graph.update({src});
+    EXPECT_EQ(src->state(), Node::State::Ready);
+    EXPECT_TRUE(sink->values.empty());
+
+    // It updates once the consumer has made room
+    graph.update();
+    EXPECT_EQ(src->state(), Node::State::Ready);
+    graph.update();
+    graph.update();
+    EXPECT_EQ(src->state(), Node::State::Idle);
+    EXPECT_EQ(sink->values, std::vector<int>({1, 2, 3}));
+    EXPECT_EQ(sink->in.size(), 0);
+}
+
+TEST(Graph, EarlyCutoff)
+{
+    using SourceNode = test::PassThroughNode<int>;
+    using SumOp = test::AdditionNode<int>;
+
+    Graph graph;
+    auto a = graph.insertNode<SourceNode>(1);
+    auto b = graph.insertNode<SourceNode>(2);
+    auto sum = graph.insertNode<SumOp>();
+    auto counter = graph.insertNode<CountingNode>();
+    connect(a->get, sum->lhs);
+    connect(b->get, sum->rhs);
+    connect(sum->result, counter->in);
+    sum->result.setEarlyCutoff(true);
+
+    graph.update();
+    EXPECT_EQ(counter->count, 1);
+
+    // Sum is recomputed but its result is unchanged
+    a->set(2);
+    b->set(1);
+    graph.update();
+    EXPECT_EQ(sum->result(), 3);
+    EXPECT_EQ(counter->count, 1);
+    EXPECT_EQ(counter->state(), Node::State::Idle);
+
+    // Changed result is propagated
+    a->set(5);
+    graph.update();
+    EXPECT_EQ(counter->count, 2);
+}
+
+TEST(Graph, Stream)
+{
+    using SourceNode = test::PassThroughNode<int>;
+    using MulOp = test::MultiplyNode<int>;
+    using SumOp = test::AdditionNode<int>;
+
+    for (std::size_t threads : {1, 4}) {
+        // Diamond: (2 * x) + (x + 1)
+        Graph graph;
+        graph.setNumThreads(threads);
+        auto src = graph.insertNode<SourceNode>();
+        auto mul = graph.insertNode<MulOp>();
+        auto add = graph.insertNode<SumOp>();
+        auto sum = graph.insertNode<SumOp>();
+        auto sink = graph.insertNode<RecordingNode>();
+        mul->rhs(2);
+        add->rhs(1);
+        connect(src->get, mul->lhs);
+        connect(src->get, add->lhs);
+        connect(mul->result, sum->lhs);
+        connect(add->result, sum->rhs);
+        connect(sum->result, sink->in);
+
+        // Feed frames
+        constexpr int numFrames{100};
+        graph.stream([&src](std::size_t tick) {
+            if (tick == numFrames) {
+                return false;
+            }
+            src->set(static_cast<int>(tick));
+            return true;
+        });
+
+        // Every frame arrives in order
+        ASSERT_EQ(sink->values.size(), numFrames);
+        for (int i = 0; i < numFrames; i++) {
+            EXPECT_EQ(sink->values[i], 3 * i + 1);
+            EXPECT_EQ(sink->ticks[i], i);
+        }
+    }
+}
+
+TEST(Graph, StreamOverlap)
+{
+    using SourceNode = test::PassThroughNode<int>;
+
+    // Each stage only waits for the next one to take its frame
+    Graph graph;
+    graph.setNumThreads(4);
+    StageNode::Activity activity;
+    auto src = graph.insertNode<SourceNode>();
+    auto first = graph.insertNode<StageNode>(&activity);
+    auto second = graph.insertNode<StageNode>(&activity);
+    auto sink = graph.insertNode<RecordingNode>();
+    connect(src->get, first->in);
+    connect(first->out, second->in);
+    connect(second->out, sink->in);
+
+    constexpr int numFrames{20};
+    graph.stream([&src](std::size_t tick) {
+        if (tick == numFrames) {
+            return false;
+        }
+        src->set(static_cast<int>(tick));
+        return true;
+    });
+
+    // The two stages computed at the same time
+    EXPECT_GE(activity.peak, 2);
+    ASSERT_EQ(sink->values.size(), numFrames);
+    for (int i = 0; i < numFrames; i++) {
+        EXPECT_EQ(sink->values[i], i);
+    }
+}
+
+TEST(Graph, StreamLazy)
+{
+    using SourceNode = test::PassThroughNode<int>;
+
+    // Pulls read the frame which was posted
+    Graph graph;
+    graph.setNumThreads(4);
+    auto src = graph.insertNode<SourceNode>();
+    auto thumb = graph.insertNode<ThumbnailNode>();
+    auto sink = graph.insertNode<RecordingNode>();
+    connect(src->get, thumb->in);
+    connect(thumb->thumbnail, sink->in);
+
+    constexpr int numFrames{50};
+    graph.stream([&src](std::size_t tick) {
+        if (tick == numFrames) {
+            return false;
+        }
+        src->set(static_cast<int>(tick));
+        return true;
+    });
+
+    ASSERT_EQ(sink->values.size(), numFrames);
+    for (int i = 0; i < numFrames; i++) {
+        EXPECT_EQ(sink->values[i], 10 * i);
+    }
+    EXPECT_EQ(thumb->renders, numFrames);
+}
+
+TEST(Graph, UpdateAsync)
+{
+    using SourceNode = test::PassThroughNode<int>;
+    using SumOp = test::AdditionNode<int>;
+
+    Graph graph;
+    auto a = graph.insertNode<SourceNode>(1);
+    auto b = graph.insertNode<SourceNode>(2);
+    auto sum = graph.insertNode<SumOp>();
+    connect(a->get, sum->lhs);
+    connect(b->get, sum->rhs);
+
+    auto handle = graph.updateAsync();
+    ASSERT_TRUE(handle.valid());
+    EXPECT_EQ(handle.get(), Graph::State::Idle);
+    EXPECT_EQ(handle.wait_for(std::chrono::seconds(0)),
+              std::future_status::ready);
+    EXPECT_EQ(handle.total(), 3);
+    EXPECT_EQ(handle.completed(), 3);
+    EXPECT_FALSE(handle.cancelled());
+    EXPECT_EQ(sum->result(), 3);
+}
+
+TEST(Graph, UpdateAsyncCancel)
+{
+    using SourceNode = test::PassThroughNode<int>;
+
+    for (std::size_t threads : {1, 2}) {
+        Graph graph;
+        graph.setNumThreads(threads);
+        auto src = graph.insertNode<SourceNode>(1);
+        auto blocker = graph.insertNode<BlockingNode>();
+        auto counter = graph.insertNode<CountingNode>();
+        connect(src->get, blocker->in);
+        connect(blocker->out, counter->in);
+
+        // Cancel while the blocking node is computing
+        auto handle = graph.updateAsync();
+        while (not blocker->started) {
+            std::this_thread::yield();
+        }
+        handle.cancel();
+        handle.wait();
+        EXPECT_TRUE(handle.cancelled());
+        EXPECT_EQ(handle.completed(), 2);
+        EXPECT_EQ(handle.total(), 3);
+
+        // Skipped nodes keep their queued updates
+        EXPECT_EQ(counter->count, 0);
+        EXPECT_EQ(counter->state(), Node::State::Ready);
+        graph.update();
+        EXPECT_EQ(counter->count, 1);
+    }
+}
@@ -1,7 +1,11 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <memory>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
 #include "smgl/TestLib.hpp"
 
@@ -191,6 +195,45 @@ TEST(Node, TestNamedRegistration)
     EXPECT_EQ(NodeFactoryType::Instance().GetRegisteredIdentifiers().size(), 0);
 }
 
+TEST(Node, ConcurrentFactory)
+{
+    using SourceNode = test::PassThroughNode<int>;
+    using OtherNode = test::PassThroughNode<float>;
+    EXPECT_TRUE(RegisterNode<SourceNode>());
+
+    // Create nodes on several threads while another type is re-registered
+    std::atomic<bool> done{false};
+    std::thread registrar([&done]() {
+        while (not done) {
+            RegisterNode<OtherNode>();
+            DeregisterNode<OtherNode>();
+        }
+    });
+    std::vector<std::thread> workers;
+    std::vector<std::unordered_set<Uuid>> uuids(4);
+    for (std::size_t t = 0; t < uuids.size(); t++) {
+        workers.emplace_back([&uuids, t]() {
+            for (int i = 0; i < 200; i++) {
+                auto n = CreateNode("smgl::test::PassThroughNode<int>");
+                uuids[t].insert(n->uuid());
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    done = true;
+    registrar.join();
+
+    // Every node has a unique Uuid
+    std::unordered_set<Uuid> all;
+    for (const auto& u : uuids) {
+        all.insert(u.begin(), u.end());
+    }
+    EXPECT_EQ(all.size(), 800);
+    EXPECT_TRUE(DeregisterNode<SourceNode>());
+}
+
 TEST(Node, TestCreateUnregistered)
 {
     std::string id = "Null";
@@ -333,4 +376,31 @@ TEST(Node, SerializeNoCache)
     SumOp nodeClone;
     nodeClone.deserialize(meta, "");
     EXPECT_EQ(nodeClone.result.val(), 2);
-}
\ No newline at end of file
+}
+
+TEST(Node, UpdateState)
+{
+    test::PassThroughNode<int> src;
+    test::AdditionNode<int> op;
+    connect(src.get, op.lhs);
+    EXPECT_EQ(src.state(), Node::State::Idle);
+    EXPECT_EQ(op.state(), Node::State::Idle);
+
+    // Posting to an input makes the node ready
+    src.set(1);
+    EXPECT_EQ(src.state(), Node::State::Ready);
+
+    // Upstream notification marks downstream inputs as waiting
+    src.get.notify(Port::State::Waiting);
+    EXPECT_EQ(op.state(), Node::State::Waiting);
+
+    // Upstream update posts to downstream inputs
+    src.update();
+    EXPECT_EQ(src.state(), Node::State::Idle);
+    EXPECT_EQ(op.state(), Node::State::Ready);
+
+    // Consuming the queued updates returns the node to idle
+    op.update();
+    EXPECT_EQ(op.state(), Node::State::Idle);
+    EXPECT_EQ(op.result(), 1);
+}
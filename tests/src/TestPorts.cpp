@@ -1,5 +1,12 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
+
 #include "smgl/Ports.hpp"
 #include "smgl/TestLib.hpp"
 
@@ -22,6 +29,181 @@ TEST(InputPort, MemberFnTarget)
     EXPECT_EQ(f.result, 1);
 }
 
+TEST(InputPort, ConcurrentPost)
+{
+    // Consume on this thread while another thread posts increasing values
+    constexpr int numPosts{100000};
+    std::vector<int> received;
+    InputPort<int> port([&received](int v) { received.push_back(v); });
+    std::atomic<bool> done{false};
+    std::thread producer([&]() {
+        for (int i = 1; i <= numPosts; i++) {
+            port.post(Update<int>{i});
+        }
+        done = true;
+    });
+    while (not done) {
+        port.update();
+    }
+    producer.join();
+    port.update();
+
+    // Values may be dropped, but never reordered or duplicated
+    ASSERT_FALSE(received.empty());
+    EXPECT_TRUE(std::is_sorted(received.begin(), received.end()));
+    EXPECT_EQ(
+        std::adjacent_find(received.begin(), received.end()), received.end());
+    EXPECT_EQ(received.back(), numPosts);
+    EXPECT_EQ(port.state(), Port::State::Idle);
+}
+
+TEST(InputPort, LateQueuedState)
+{
+    // A producer can mark the port Queued after its update was consumed
+    int result{0};
+    InputPort<int> port(&result);
+    port.post(Update<int>{1});
+    EXPECT_TRUE(port.update());
+    port.setState(Port::State::Queued);
+    EXPECT_FALSE(port.update());
+    EXPECT_EQ(port.state(), Port::State::Idle);
+
+    // Waiting ports are unaffected
+    port.setState(Port::State::Waiting);
+    EXPECT_FALSE(port.update());
+    EXPECT_EQ(port.state(), Port::State::Waiting);
+}
+
+TEST(QueuedInputPort, DropOldest)
+{
+    std::vector<int> received;
+    QueuedInputPort<int, 3> port(
+        [&received](int v) { received.push_back(v); },
+        OverflowPolicy::DropOldest);
+    for (int i = 0; i < 5; i++) {
+        port.post(i);
+    }
+    EXPECT_TRUE(port.full());
+    EXPECT_EQ(port.state(), Port::State::Queued);
+
+    // Values are consumed one at a time, oldest first
+    while (port.update()) {
+    }
+    EXPECT_EQ(received, std::vector<int>({2, 3, 4}));
+    EXPECT_EQ(port.size(), 0);
+    EXPECT_EQ(port.state(), Port::State::Idle);
+}
+
+TEST(QueuedInputPort, DropNewest)
+{
+    std::vector<int> received;
+    QueuedInputPort<int, 3> port(
+        [&received](int v) { received.push_back(v); },
+        OverflowPolicy::DropNewest);
+    for (int i = 0; i < 5; i++) {
+        port.post(i);
+    }
+    EXPECT_TRUE(port.update());
+    EXPECT_EQ(port.state(), Port::State::Queued);
+    while (port.update()) {
+    }
+    EXPECT_EQ(received, std::vector<int>({0, 1, 2}));
+}
+
+TEST(QueuedInputPort, Block)
+{
+    // Every value from the producer thread is received in order
+    constexpr int numPosts{10000};
+    std::vector<int> received;
+    QueuedInputPort<int, 4> port(
+        [&received](int v) { received.push_back(v); });
+    std::thread producer([&]() {
+        for (int i = 0; i < numPosts; i++) {
+            port.post(i);
+        }
+    });
+    while (received.size() < numPosts) {
+        port.update();
+    }
+    producer.join();
+
+    std::vector<int> expected(numPosts);
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_EQ(received, expected);
+}
+
+TEST(QueuedInputPort, Backpressure)
+{
+    int input{0};
+    OutputPort<int> source(&input);
+    std::vector<int> received;
+    QueuedInputPort<int, 2> target(
+        [&received](int v) { received.push_back(v); },
+        OverflowPolicy::DropNewest);
+    connect(source, target);
+    EXPECT_FALSE(source.blocked());
+
+    // Only post while the queue has space
+    for (input = 1; input <= 4; input++) {
+        if (not source.blocked()) {
+            source.update();
+        }
+    }
+    EXPECT_TRUE(source.blocked());
+    while (target.update()) {
+    }
+    EXPECT_EQ(received, std::vector<int>({1, 2}));
+    EXPECT_FALSE(source.blocked());
+}
+
+TEST(GatherInputPort, Gather)
+{
+    int a{1};
+    int b{2};
+    OutputPort<int> srcA(&a);
+    OutputPort<int> srcB(&b);
+    std::vector<int> result;
+    GatherInputPort<int> target(&result);
+    connect(srcA, target);
+    connect(srcB, target);
+    EXPECT_EQ(target.numConnections(), 2);
+
+    // Waits for every source to post
+    EXPECT_EQ(target.state(), Port::State::Waiting);
+    srcA.update();
+    EXPECT_FALSE(target.update());
+    srcB.update();
+    EXPECT_EQ(target.state(), Port::State::Queued);
+
+    // Values are in connection order
+    EXPECT_TRUE(target.update());
+    EXPECT_EQ(result, std::vector<int>({1, 2}));
+    EXPECT_EQ(target.state(), Port::State::Idle);
+    EXPECT_FALSE(target.update());
+
+    // Waits for every waiting source
+    srcA.notify(Port::State::Waiting);
+    srcB.notify(Port::State::Waiting);
+    a = 3;
+    srcA.update();
+    EXPECT_EQ(target.state(), Port::State::Waiting);
+    EXPECT_FALSE(target.update());
+    srcB.notify(Port::State::Idle);
+    EXPECT_EQ(target.state(), Port::State::Queued);
+    EXPECT_TRUE(target.update());
+    EXPECT_EQ(result, std::vector<int>({3, 2}));
+
+    // Disconnected sources are removed from the values
+    disconnect(srcA, target);
+    EXPECT_EQ(target.numConnections(), 1);
+    b = 4;
+    srcB.update();
+    EXPECT_TRUE(target.update());
+    EXPECT_EQ(result, std::vector<int>({4}));
+
+    EXPECT_THROW(target.post(Update<int>{1}), bad_connection);
+}
+
 TEST(OutputPort, VariableConstantSource)
 {
     int source = 0;
@@ -92,6 +274,81 @@ TEST(OutputPort, MemberFnWithArg)
     EXPECT_EQ(port.val(), 2);
 }
 
+TEST(OutputPort, Ref)
+{
+    // Pointer sources are not copied
+    int source = 1;
+    OutputPort<int> ptrPort(&source);
+    EXPECT_EQ(&ptrPort.ref(), &source);
+
+    // Constant sources are stored in the port
+    OutputPort<int> constPort(2);
+    EXPECT_EQ(&constPort.ref(), &constPort.ref());
+    EXPECT_EQ(constPort.ref(), 2);
+
+    // Function sources are cached
+    int calls = 0;
+    OutputPort<int> fnPort([&calls]() { return ++calls; });
+    EXPECT_EQ(fnPort.ref(), 1);
+    EXPECT_EQ(fnPort.ref(), 2);
+}
+
+TEST(OutputPort, Lazy)
+{
+    int calls{0};
+    OutputPort<int> source([&calls]() { return ++calls; });
+    source.setLazy(true);
+    int a{0};
+    int b{0};
+    InputPort<int> targetA(&a);
+    InputPort<int> targetB(&b);
+    connect(source, targetA);
+    connect(source, targetB);
+
+    // Updating the source does not evaluate it
+    source.update();
+    EXPECT_EQ(calls, 0);
+    EXPECT_EQ(targetA.state(), Port::State::Queued);
+
+    // The first read evaluates the source for every connection
+    targetA.update();
+    targetB.update();
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(a, 1);
+    EXPECT_EQ(b, 1);
+    EXPECT_EQ(source.val(), 1);
+    EXPECT_EQ(calls, 1);
+
+    // Unread values are never computed
+    source.update();
+    source.update();
+    EXPECT_EQ(calls, 1);
+    targetA.update();
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(a, 2);
+
+    // Disconnected sources are not read
+    source.update();
+    disconnect(source, targetB);
+    EXPECT_FALSE(targetB.update());
+    EXPECT_EQ(targetB.state(), Port::State::Idle);
+    EXPECT_EQ(calls, 2);
+
+    // Every read receives the whole value
+    OutputPort<std::vector<int>> vecSource(
+        []() { return std::vector<int>(4, 1); });
+    vecSource.setLazy(true);
+    std::vector<int> vec;
+    InputPort<std::vector<int>> vecTarget(&vec);
+    connect(vecSource, vecTarget);
+    vecSource.update();
+    vecTarget.update();
+    EXPECT_EQ(vec.size(), 4);
+    EXPECT_EQ(vecSource.val().size(), 4);
+    EXPECT_EQ(vecSource.val().size(), 4);
+    EXPECT_EQ(vecSource.ref().size(), 4);
+}
+
 TEST(Ports, IOConnectionBasic)
 {
     int expected = test::FreeFnSource();
@@ -228,4 +485,294 @@ TEST(Ports, AutoDisconnect)
     // Connections should have been severed
     EXPECT_EQ(outGood.numConnections(), 0);
     EXPECT_EQ(inGood.numConnections(), 0);
-}
\ No newline at end of file
+}
+
+TEST(Ports, WideFanOut)
+{
+    // Enough connections to spill inline storage and build the index
+    constexpr std::size_t numInputs{64};
+    int input{1};
+    OutputPort<int> source(&input);
+    std::vector<int> results(numInputs, 0);
+    std::vector<std::unique_ptr<InputPort<int>>> targets;
+    for (auto& r : results) {
+        targets.emplace_back(new InputPort<int>(&r));
+        connect(source, *targets.back());
+    }
+    EXPECT_EQ(source.numConnections(), numInputs);
+
+    // Reconnecting an existing connection does not add a new one
+    connect(source, *targets.front());
+    EXPECT_EQ(source.numConnections(), numInputs);
+
+    // Disconnect every other target
+    for (std::size_t i = 0; i < numInputs; i += 2) {
+        disconnect(source, *targets[i]);
+    }
+    EXPECT_EQ(source.numConnections(), numInputs / 2);
+
+    // Only connected targets are updated
+    input = 2;
+    source.update();
+    for (std::size_t i = 0; i < numInputs; i++) {
+        targets[i]->update();
+        EXPECT_EQ(results[i], (i % 2 == 0) ? 0 : 2);
+    }
+
+    // Disconnect below the index threshold, then reconnect everything
+    for (std::size_t i = 1; i < numInputs - 2; i += 2) {
+        disconnect(source, *targets[i]);
+    }
+    EXPECT_EQ(source.numConnections(), 1);
+    for (auto& t : targets) {
+        connect(source, *t);
+    }
+    EXPECT_EQ(source.numConnections(), numInputs);
+
+    input = 3;
+    source.update();
+    for (std::size_t i = 0; i < numInputs; i++) {
+        targets[i]->update();
+        EXPECT_EQ(results[i], 3);
+    }
+}
+
+TEST(Ports, EarlyCutoff)
+{
+    int input{1};
+    int result{0};
+    OutputPort<int> source(&input);
+    InputPort<int> target(&result);
+    connect(source, target);
+    EXPECT_FALSE(source.earlyCutoff());
+    source.setEarlyCutoff(true);
+    EXPECT_TRUE(source.earlyCutoff());
+
+    // First value is always posted
+    source.update();
+    EXPECT_EQ(target.state(), Port::State::Queued);
+    EXPECT_TRUE(target.update());
+    EXPECT_EQ(result, 1);
+
+    // Unchanged value returns the target to Idle
+    target.notify(Port::State::Waiting);
+    source.update();
+    EXPECT_EQ(target.state(), Port::State::Idle);
+    EXPECT_FALSE(target.update());
+
+    // Changed value is posted
+    input = 2;
+    source.update();
+    EXPECT_EQ(target.state(), Port::State::Queued);
+
+    // Unapplied updates are kept when the value is unchanged
+    target.notify(Port::State::Waiting);
+    source.update();
+    EXPECT_EQ(target.state(), Port::State::Queued);
+    EXPECT_TRUE(target.update());
+    EXPECT_EQ(result, 2);
+
+    // Custom comparator
+    source.setComparator(
+        [](const int& a, const int& b) { return a / 2 == b / 2; });
+    source.update();
+    target.update();
+    input = 3;
+    source.update();
+    EXPECT_EQ(target.state(), Port::State::Idle);
+    EXPECT_EQ(result, 2);
+}
+
+namespace
+{
+struct CopyCounter {
+    static int copies;
+    CopyCounter() = default;
+    CopyCounter(const CopyCounter&) { copies++; }
+    CopyCounter(CopyCounter&&) noexcept = default;
+    CopyCounter& operator=(const CopyCounter&)
+    {
+        copies++;
+        return *this;
+    }
+    CopyCounter& operator=(CopyCounter&&) noexcept = default;
+};
+int CopyCounter::copies{0};
+}  // namespace
+
+TEST(Ports, MinimalCopies)
+{
+    CopyCounter input;
+    CopyCounter r0;
+    CopyCounter r1;
+    OutputPort<CopyCounter> source(&input);
+    InputPort<CopyCounter> t0(&r0);
+    InputPort<CopyCounter> t1(&r1);
+    connect(source, t0);
+
+    // One copy out of the source
+    CopyCounter::copies = 0;
+    source.update();
+    t0.update();
+    EXPECT_EQ(CopyCounter::copies, 1);
+
+    // Plus one copy for every additional connection
+    connect(source, t1);
+    CopyCounter::copies = 0;
+    source.update();
+    t0.update();
+    t1.update();
+    EXPECT_EQ(CopyCounter::copies, 2);
+}
+
+TEST(Ports, GatherNoCopy)
+{
+    CopyCounter a;
+    CopyCounter b;
+    OutputPort<CopyCounter> srcA(&a);
+    OutputPort<CopyCounter> srcB(&b);
+    srcA.setMoveSource(true);
+    srcB.setMoveSource(true);
+    std::size_t received{0};
+    GatherInputPort<CopyCounter> target(
+        [&received](const std::vector<CopyCounter>& v) {
+            received = v.size();
+        });
+    connect(srcA, target);
+    connect(srcB, target);
+
+    // Gathered values are moved in and passed by reference
+    CopyCounter::copies = 0;
+    srcA.update();
+    srcB.update();
+    EXPECT_TRUE(target.update());
+    EXPECT_EQ(received, 2);
+    EXPECT_EQ(target.values().size(), 2);
+    EXPECT_EQ(CopyCounter::copies, 0);
+
+    // Unchanged values are kept without copying
+    srcA.notify(Port::State::Waiting);
+    srcA.update();
+    EXPECT_TRUE(target.update());
+    EXPECT_EQ(CopyCounter::copies, 0);
+}
+
+TEST(Ports, SharedPayload)
+{
+    auto input = std::make_shared<const std::vector<int>>(1024, 1);
+    Shared<std::vector<int>> r0;
+    Shared<std::vector<int>> r1;
+    SharedOutputPort<std::vector<int>> source(&input);
+    SharedInputPort<std::vector<int>> t0(&r0);
+    SharedInputPort<std::vector<int>> t1(&r1);
+    connect(source, t0);
+    connect(source, t1);
+
+    // All consumers share the source's object
+    source.update();
+    t0.update();
+    t1.update();
+    EXPECT_EQ(r0, input);
+    EXPECT_EQ(r1, input);
+}
+
+TEST(Ports, MoveSource)
+{
+    CopyCounter input;
+    CopyCounter result;
+    OutputPort<CopyCounter> source(&input);
+    InputPort<CopyCounter> target(&result);
+    connect(source, target);
+    EXPECT_FALSE(source.moveSource());
+    source.setMoveSource(true);
+    EXPECT_TRUE(source.moveSource());
+
+    // Single consumer is moved end-to-end
+    CopyCounter::copies = 0;
+    source.update();
+    target.update();
+    EXPECT_EQ(CopyCounter::copies, 0);
+}
+
+TEST(Ports, MoveSourceEarlyCutoff)
+{
+    std::vector<int> input{1, 2, 3};
+    std::vector<int> result;
+    OutputPort<std::vector<int>> source(&input);
+    InputPort<std::vector<int>> target(&result);
+    connect(source, target);
+    source.setMoveSource(true);
+    source.setEarlyCutoff(true);
+
+    // Changed value is moved to the target
+    source.update();
+    target.update();
+    EXPECT_EQ(result, std::vector<int>({1, 2, 3}));
+    EXPECT_TRUE(input.empty());
+
+    // Unchanged value is left in the source
+    input = {1, 2, 3};
+    target.notify(Port::State::Waiting);
+    EXPECT_FALSE(source.update());
+    EXPECT_EQ(target.state(), Port::State::Idle);
+    EXPECT_EQ(input, std::vector<int>({1, 2, 3}));
+    EXPECT_EQ(result, std::vector<int>({1, 2, 3}));
+}
+
+TEST(Ports, MoveOnly)
+{
+    auto input = std::make_unique<int>(5);
+    std::unique_ptr<int> result;
+    OutputPort<std::unique_ptr<int>> source(&input);
+    InputPort<std::unique_ptr<int>> target(&result);
+    EXPECT_TRUE(source.moveSource());
+    connect(source, target);
+
+    // Connecting does not take the value from the source
+    EXPECT_EQ(target.state(), Port::State::Idle);
+    ASSERT_NE(input, nullptr);
+
+    // Value is handed off to the target
+    source.update();
+    target.update();
+    ASSERT_NE(result, nullptr);
+    EXPECT_EQ(*result, 5);
+    EXPECT_EQ(input, nullptr);
+
+    // Only one consumer is allowed
+    std::unique_ptr<int> other;
+    InputPort<std::unique_ptr<int>> otherTarget(&other);
+    EXPECT_THROW(connect(source, otherTarget), smgl::bad_connection);
+
+    // Member function targets receive the moved value
+    struct Sink {
+        std::unique_ptr<int> value;
+        void set(std::unique_ptr<int> v) { value = std::move(v); }
+    } sink;
+    input = std::make_unique<int>(7);
+    OutputPort<std::unique_ptr<int>> memberSource(&input);
+    InputPort<std::unique_ptr<int>> memberTarget(&sink, &Sink::set);
+    connect(memberSource, memberTarget);
+    memberSource.update();
+    memberTarget.update();
+    ASSERT_NE(sink.value, nullptr);
+    EXPECT_EQ(*sink.value, 7);
+}
+
+TEST(Ports, EarlyCutoffNoCopy)
+{
+    CopyCounter input;
+    CopyCounter result;
+    OutputPort<CopyCounter> source(&input);
+    InputPort<CopyCounter> target(&result);
+    connect(source, target);
+    source.setComparator(
+        [](const CopyCounter&, const CopyCounter&) { return true; });
+    source.update();
+    target.update();
+
+    // Unchanged values are compared by reference
+    CopyCounter::copies = 0;
+    source.update();
+    EXPECT_EQ(CopyCounter::copies, 0);
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "smgl/ThreadPool.hpp"
+
+using namespace smgl;
+
+TEST(ThreadPool, DefaultThreadCount)
+{
+    ThreadPool pool;
+    EXPECT_EQ(pool.size(), ThreadPool::DefaultThreadCount());
+    EXPECT_GE(pool.size(), 1);
+}
+
+TEST(ThreadPool, RunsAllTasks)
+{
+    std::atomic<int> count{0};
+    {
+        ThreadPool pool(4);
+        EXPECT_EQ(pool.size(), 4);
+        for (int i = 0; i < 1000; i++) {
+            pool.submit([&count]() { count++; });
+        }
+    }
+    // ~ThreadPool() finishes all queued tasks
+    EXPECT_EQ(count, 1000);
+}
+
+TEST(ThreadPool, NestedSubmit)
+{
+    constexpr int numTasks{100};
+    std::mutex mutex;
+    std::condition_variable cv;
+    int count{0};
+
+    ThreadPool pool(2);
+    for (int i = 0; i < numTasks; i++) {
+        // Tasks submitted from workers are queued locally
+        pool.submit([&]() {
+            pool.submit([&]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (++count == numTasks) {
+                    cv.notify_all();
+                }
+            });
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&count]() { return count == numTasks; });
+    EXPECT_EQ(count, numTasks);
+}
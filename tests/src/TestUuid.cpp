@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <functional>
+
 #include "smgl/Uuid.hpp"
 
 using namespace smgl;
@@ -29,4 +31,16 @@ TEST(Uuid, StringFunctions)
     auto uuidClone = Uuid::FromString(str);
     EXPECT_FALSE(uuidClone.is_nil());
     EXPECT_EQ(uuid, uuidClone);
-}
\ No newline at end of file
+}
+
+TEST(Uuid, Hash)
+{
+    auto uuid = Uuid::FromString("2d243fb2-91c8-48ef-beb7-fb60966b2316");
+    auto uuidClone = Uuid::FromString(uuid.string());
+    EXPECT_EQ(std::hash<Uuid>{}(uuid), std::hash<Uuid>{}(uuidClone));
+    EXPECT_EQ(std::hash<Uuid>{}(uuid), uuid.hash());
+
+    // Uuids which only differ in their last half have different hashes
+    auto other = Uuid::FromString("2d243fb2-91c8-48ef-beb7-fb60966b2317");
+    EXPECT_NE(uuid.hash(), other.hash());
+}